@@ -0,0 +1,91 @@
+#ifdef USE_ALSA
+
+#include "AlsaSink.hpp"
+#include <alsa/asoundlib.h>
+#include <iostream>
+
+using std::string;
+using std::size_t;
+using std::cerr;
+using std::endl;
+using std::chrono::microseconds;
+
+//==============================================================================
+//-------------------------------- AlsaSink ------------------------------------
+//==============================================================================
+const unsigned int AlsaSink::LATENCY_MICROSECONDS (50000);
+
+AlsaSink::AlsaSink (const string& device)
+: _device (device)
+, _pcm (nullptr) {
+}
+AlsaSink::~AlsaSink() {
+    if (_pcm != nullptr) {
+        snd_pcm_close(_pcm);
+    }
+}
+bool AlsaSink::open() {
+    int result = snd_pcm_open(&_pcm, _device.c_str(),
+                              SND_PCM_STREAM_PLAYBACK, 0);
+    if (result < 0) {
+        // Note: A busy device is used by another output for a moment.
+        if (result != -EBUSY) {
+            cerr << "Unable to open ALSA device " << _device << ": "
+                 << snd_strerror(result) << endl;
+        }
+        _pcm = nullptr;
+        return false;
+    }
+    result = snd_pcm_set_params(_pcm, SND_PCM_FORMAT_S16,
+            SND_PCM_ACCESS_RW_INTERLEAVED, CHANNELS, SAMPLE_RATE,
+            1 /* allow resampling */, LATENCY_MICROSECONDS);
+    if (result < 0) {
+        cerr << "Unable to configure ALSA device " << _device << ": "
+             << snd_strerror(result) << endl;
+        snd_pcm_close(_pcm);
+        _pcm = nullptr;
+        return false;
+    }
+    return true;
+}
+void AlsaSink::close() {
+    if (_pcm != nullptr) {
+        snd_pcm_drain(_pcm);
+        snd_pcm_close(_pcm);
+        _pcm = nullptr;
+    }
+}
+void AlsaSink::drop() {
+    if (_pcm != nullptr) {
+        snd_pcm_drop(_pcm);
+        snd_pcm_prepare(_pcm);
+    }
+}
+void AlsaSink::write (const char* data, size_t size) {
+    snd_pcm_uframes_t frames = size / FRAME_SIZE;
+    while (frames > 0) {
+        snd_pcm_sframes_t written = snd_pcm_writei(_pcm, data, frames);
+        if (written < 0) {
+            // Note: An underrun of the device is recovered by preparing it
+            // again, the audio is written once more.
+            if (snd_pcm_recover(_pcm, written, 1 /* silent */) < 0) {
+                cerr << "Unable to write to ALSA device " << _device << ": "
+                     << snd_strerror(written) << endl;
+                return;
+            }
+            continue;
+        }
+        data += written * FRAME_SIZE;
+        frames -= written;
+    }
+}
+microseconds AlsaSink::getDelay() const {
+    snd_pcm_sframes_t frames = 0;
+    if (_pcm == nullptr || snd_pcm_delay(_pcm, &frames) < 0 || frames < 0) {
+        return microseconds(0);
+    }
+    return microseconds(static_cast<long long>(frames) * 1000000 /
+                        SAMPLE_RATE);
+}
+
+#endif	/* USE_ALSA */
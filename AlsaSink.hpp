@@ -0,0 +1,38 @@
+#ifndef ALSA_SINK_HPP
+#define	ALSA_SINK_HPP
+
+#include "PcmSink.hpp"
+#include <string>
+
+struct _snd_pcm;
+
+/**
+ * Sink that plays the audio on an ALSA device.
+ *
+ * Only available if the program is built with USE_ALSA.
+ */
+class AlsaSink : public PcmSink {
+public:
+    /**
+     * Constructor. The device is opened by open.
+     * @param device The name of the device, e.g. "default".
+     */
+    AlsaSink (const std::string& device);
+    AlsaSink (const AlsaSink&) = delete;
+    AlsaSink& operator= (const AlsaSink&) = delete;
+    ~AlsaSink();
+    bool open() override;
+    void close() override;
+    void drop() override;
+    void write (const char* data, std::size_t size) override;
+    std::chrono::microseconds getDelay() const override;
+
+private:
+    /** The time of audio the device buffers. */
+    static const unsigned int LATENCY_MICROSECONDS;
+    const std::string _device;
+    _snd_pcm* _pcm;
+};
+
+#endif	/* ALSA_SINK_HPP */
+
@@ -1,20 +1,69 @@
 #include "ChildProgram.hpp"
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
 #include <unistd.h>
 #include <sstream>
 #include <errno.h>
 #include <string.h>
-#include <thread>
-#include <chrono>
-#include <iostream>
 #include <boost/asio/io_service.hpp>
+#include <boost/asio/placeholders.hpp>
+#include <boost/asio/signal_set.hpp>
+#include <boost/bind.hpp>
+
+extern char** environ;
 
-using std::cerr;
-using std::endl;
 using std::string;
 using std::vector;
 using std::ostringstream;
+using std::shared_ptr;
+using std::unique_ptr;
+using std::make_shared;
+using boost::bind;
 using boost::asio::io_service;
+using boost::asio::signal_set;
 using boost::asio::posix::stream_descriptor;
+using boost::asio::placeholders::error;
+using boost::system::error_code;
+
+namespace {
+    /**
+     * Open a file descriptor that refers to the given process. It becomes
+     * readable as soon as the process has terminated.
+     * @param pid The process id.
+     * @return The pidfd or -1 if the kernel does not support pidfds.
+     */
+    int openPidfd (int pid) {
+#ifdef SYS_pidfd_open
+        return syscall(SYS_pidfd_open, pid, 0);
+#else
+        return -1;
+#endif
+    }
+    void closePipe (int fileDescriptors[2]) {
+        for (int i=0; i<2; i++) {
+            if (fileDescriptors[i] >= 0) {
+                close(fileDescriptors[i]);
+            }
+        }
+    }
+}
+
+/**
+ * The state of the child shared with the handler waiting for its exit, which
+ * may outlive the ChildProgram.
+ */
+struct ChildProgram::Exit {
+    Exit (int pid, io_service& ioService);
+    int pid;
+    bool reaped;
+    /** Readable as soon as the child has terminated. */
+    unique_ptr<stream_descriptor> pidfd;
+    /** Used instead of the pidfd if the kernel does not support pidfds. */
+    unique_ptr<signal_set> signals;
+};
 
 //==============================================================================
 //----------------------------- ChildProgram -----------------------------------
@@ -26,62 +75,75 @@ ChildProgram::ChildProgram (const string& executable,
 , _inFileDescriptor(0)
 , _outFileDescriptor(0)
 , _errFileDescriptor(0)
-, _ioService (ioService) {
-    int fdChildStdIn[2];
-    int fdChildStdOut[2];
-    int fdChildStdErr[2];
+, _ioService (ioService)
+, _waitingForExit (false) {
+    int fdChildStdIn[2] = {-1, -1};
+    int fdChildStdOut[2] = {-1, -1};
+    int fdChildStdErr[2] = {-1, -1};
 
-    if (pipe(fdChildStdIn) < 0) {
-        throw CreationException("Unable to create pipe for child's stdin",
-                errno);
-    } else if (pipe(fdChildStdOut) < 0) {
-        throw CreationException("Unable to create pipe for child's stdout",
-                errno);
-    } else if (pipe(fdChildStdErr) < 0) {
-        throw CreationException("Unable to create pipe for child's stderr",
-                errno);
+    // Note: All ends of the pipes are closed on exec. The ends of the child
+    // are duplicated to its standard streams, which stay open.
+    if (pipe2(fdChildStdIn, O_CLOEXEC) < 0 ||
+        pipe2(fdChildStdOut, O_CLOEXEC) < 0 ||
+        pipe2(fdChildStdErr, O_CLOEXEC) < 0) {
+        int errorNumber = errno;
+        closePipe(fdChildStdIn);
+        closePipe(fdChildStdOut);
+        closePipe(fdChildStdErr);
+        throw CreationException("Unable to create pipes for the child",
+                errorNumber);
     }
-    ioService.notify_fork (io_service::fork_prepare);
-    pid_t pid = fork();
-    if (pid < 0) {
-        throw CreationException("Error in creating the child process.");
-    } else if (pid == 0) {
-        ioService.notify_fork (io_service::fork_child);
-        // Child process
+    posix_spawn_file_actions_t fileActions;
+    posix_spawn_file_actions_init(&fileActions);
+    posix_spawn_file_actions_adddup2(&fileActions, fdChildStdIn[0],
+                                     STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&fileActions, fdChildStdOut[1],
+                                     STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&fileActions, fdChildStdErr[1],
+                                     STDERR_FILENO);
+    // Note: The signals ignored by this program (e.g. SIGPIPE) would stay
+    // ignored by the child.
+    posix_spawnattr_t attributes;
+    posix_spawnattr_init(&attributes);
+    sigset_t defaultSignals;
+    sigemptyset(&defaultSignals);
+    sigaddset(&defaultSignals, SIGPIPE);
+    posix_spawnattr_setsigdefault(&attributes, &defaultSignals);
+    posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETSIGDEF);
+    // Note: The arguments are not copied, the child shares the memory of
+    // this process until it has executed the program.
+    vector<char*> argsArray;
+    argsArray.push_back(const_cast<char*>(executable.c_str()));
+    for (const string& arg : args) {
+        argsArray.push_back(const_cast<char*>(arg.c_str()));
+    }
+    argsArray.push_back(nullptr);
+    pid_t pid = 0;
+    int spawnError = posix_spawn(&pid, executable.c_str(), &fileActions,
+                                 &attributes, argsArray.data(), environ);
+    posix_spawn_file_actions_destroy(&fileActions);
+    posix_spawnattr_destroy(&attributes);
+    close(fdChildStdIn[0]);
+    close(fdChildStdOut[1]);
+    close(fdChildStdErr[1]);
+    if (spawnError != 0) {
         close(fdChildStdIn[1]);
         close(fdChildStdOut[0]);
         close(fdChildStdErr[0]);
-        safeDup2(fdChildStdIn[0], STDIN_FILENO);
-        safeDup2(fdChildStdOut[1], STDOUT_FILENO);
-        safeDup2(fdChildStdErr[1], STDERR_FILENO);
-        close(fdChildStdIn[0]);
-        close(fdChildStdOut[1]);
-        close(fdChildStdErr[1]);
-        char** argsArray = new char*[args.size() + 2];
-        argsArray[0] = new char[executable.length()+1];
-        strcpy(argsArray[0], executable.c_str());
-        argsArray[args.size()+ 1] = nullptr;
-        for (int i=0; i<args.size(); i++) {
-            const string& arg = args[i];
-            argsArray[i+1] = new char[arg.length()+1];
-            strcpy(argsArray[i+1], arg.c_str());
-        }
-        if (execv (executable.c_str(), argsArray) == -1) {
-            cerr << "Unable to start child program." << strerror(errno);
-        }
-        for (int i=0; i<args.size()+1; i++) {
-            delete[] argsArray[i];
-        }
-        delete[] argsArray;
-    } else {
-        ioService.notify_fork (io_service::fork_parent);
-        // Parent process
-        close(fdChildStdIn[0]);
-        close(fdChildStdOut[1]);
-        close(fdChildStdErr[1]);
-        _inFileDescriptor = fdChildStdIn[1];
-        _outFileDescriptor = fdChildStdOut[0];
-        _errFileDescriptor = fdChildStdErr[0];
+        throw CreationException("Unable to start " + executable, spawnError);
+    }
+    _pid = pid;
+    _inFileDescriptor = fdChildStdIn[1];
+    _outFileDescriptor = fdChildStdOut[0];
+    _errFileDescriptor = fdChildStdErr[0];
+    _exit = make_shared<Exit>(pid, ioService);
+}
+ChildProgram::~ChildProgram() {
+    kill();
+    if (!_waitingForExit && !_exit->reaped) {
+        // Note: A killed child terminates right away.
+        waitpid(_pid, nullptr, 0);
+        _exit->reaped = true;
     }
 }
 stream_descriptor ChildProgram::in() const {
@@ -96,17 +158,52 @@ stream_descriptor ChildProgram::err() const {
 int ChildProgram::pid() const {
     return _pid;
 }
-void ChildProgram::safeDup2(int sourceFD, int destFD) throw (CreationException) {
-    int dup2ReturnCode = 0;
-    for (;;) {
-        dup2ReturnCode = dup2(sourceFD, destFD);
-        if (dup2ReturnCode >= 0 || errno != EINTR) {
-            break;
-        }
+void ChildProgram::asyncWaitForExit (const ExitHandler& handler) {
+    _waitingForExit = true;
+    if (_exit->pidfd) {
+        _exit->pidfd->async_wait(stream_descriptor::wait_read,
+                bind(&ChildProgram::handleExit, _exit, handler, error));
+    } else {
+        // Note: The child may have terminated before SIGCHLD was waited for.
+        _ioService.post(bind(&ChildProgram::handleExit, _exit, handler,
+                             error_code()));
+    }
+}
+void ChildProgram::kill() {
+    // Note: The process id is not reused before the child has been reaped.
+    if (!_exit->reaped) {
+        ::kill(_pid, SIGKILL);
+    }
+}
+void ChildProgram::handleExit (const shared_ptr<Exit>& exit,
+                               const ExitHandler& handler,
+                               const error_code& error) {
+    if (error || exit->reaped) {
+        return;
+    }
+    int status = 0;
+    // Note: SIGCHLD may have been sent for another child, whereas the pidfd
+    // is only readable if this child has terminated.
+    pid_t pid = waitpid(exit->pid, &status, exit->pidfd ? 0 : WNOHANG);
+    if (pid == exit->pid) {
+        exit->reaped = true;
+        handler(status);
+    } else if (exit->signals) {
+        exit->signals->async_wait(bind(&ChildProgram::handleExit, exit,
+                handler, boost::asio::placeholders::error));
     }
-    if (dup2ReturnCode < 0) {
-        throw CreationException("Unable to perform dup2 for file-descriptor",
-                dup2ReturnCode);
+}
+//==============================================================================
+//-------------------------- ChildProgram::Exit --------------------------------
+//==============================================================================
+ChildProgram::Exit::Exit (int pid, io_service& ioService)
+: pid (pid)
+, reaped (false) {
+    int fileDescriptor = openPidfd(pid);
+    if (fileDescriptor >= 0) {
+        pidfd.reset(new stream_descriptor (ioService, fileDescriptor));
+    } else {
+        signals.reset(new signal_set (ioService, SIGCHLD));
     }
 }
 //==============================================================================
@@ -119,8 +216,8 @@ ChildProgram::CreationException::CreationException(const string& message)
 ChildProgram::CreationException::CreationException(const std::string& message,
         int errorNumber) {
     ostringstream oss;
-    oss << message << ": errno=" << errorNumber << "(" << strerror(errno) <<
-            ")";
+    oss << message << ": errno=" << errorNumber << "(" <<
+            strerror(errorNumber) << ")";
     _message = oss.str();
 }
 ChildProgram::CreationException::~CreationException() throw () {
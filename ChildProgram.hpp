@@ -4,12 +4,17 @@
 #include <string>
 #include <vector>
 #include <exception>
+#include <functional>
+#include <memory>
 #include <boost/asio/posix/stream_descriptor.hpp>
 
 namespace boost {
     namespace asio {
         class io_service;
     }
+    namespace system {
+        class error_code;
+    }
 }
 
 class ChildProgram {
@@ -24,30 +29,57 @@ public:
             std::string _message;
     };
     typedef boost::asio::posix::stream_descriptor StreamDescriptor;
+    typedef std::function<void(int waitpidStatus)> ExitHandler;
+    /**
+     * Start the given program with posix_spawn. Its standard input and output
+     * are connected to pipes, which are closed on exec, so they are not
+     * inherited by other programs started later on.
+     * @param executable The path of the program.
+     * @param commandLine The arguments of the program.
+     * @param ioService The io_service the pipes and the exit of the program
+     *                  are handled in.
+     * @exception CreationException Thrown if the pipes could not be created
+     *            or the program could not be started.
+     */
     ChildProgram (const std::string& executable,
             const std::vector<std::string>& commandLine,
             boost::asio::io_service& _ioService) throw (CreationException);
+    ChildProgram (const ChildProgram&) = delete;
+    ChildProgram& operator= (const ChildProgram&) = delete;
+    /**
+     * Destructor. Kills the program if it is still running. It is reaped by
+     * the handler waiting for its exit, if there is one.
+     */
+    ~ChildProgram();
     StreamDescriptor in() const;
     StreamDescriptor out() const;
     StreamDescriptor err() const;
     int pid() const;
-protected:
     /**
-     * Call dup2 system call and repeat this until it works - to prevent from
-     * the case being interrupted by a signal.
-     * @parm sourceFD The source file descriptor. This remains open after the
-     *                call to dup2.
-     * @parm destFD The destination file descriptor. This file descriptor will
-     *              point to the same file as filedes after this call returns.
-     * @exception Thrown for other errors than EINTR - interrupted function
-     *            call. */
-    static void safeDup2 (int sourceFD, int destFD) throw (CreationException);
+     * Wait asynchronously until the program has terminated and reap it. The
+     * exit is noticed by a pidfd, on kernels without pidfds (before Linux
+     * 5.3) by SIGCHLD. The handler is even called if this object has been
+     * destroyed meanwhile. Must be called once at most.
+     * @param handler Called with the status returned by waitpid.
+     */
+    void asyncWaitForExit (const ExitHandler& handler);
+    /**
+     * Kill the program (SIGKILL), unless it has already been reaped.
+     */
+    void kill();
+protected:
+    struct Exit;
+    static void handleExit (const std::shared_ptr<Exit>& exit,
+                            const ExitHandler& handler,
+                            const boost::system::error_code& error);
 private:
     int _pid;
     int _inFileDescriptor;
     int _outFileDescriptor;
     int _errFileDescriptor;
     boost::asio::io_service& _ioService;
+    std::shared_ptr<Exit> _exit;
+    bool _waitingForExit;
 };
 
 #endif	/* CHILDPROGRAM_HPP */
@@ -0,0 +1,95 @@
+#include "CollationKey.hpp"
+#include <algorithm>
+#include <utility>
+
+using std::string;
+using std::vector;
+using std::size_t;
+using std::pair;
+using std::min;
+
+namespace {
+    /** Starts a run of digits. Followed by the number of digits and the
+     *  digits themselves. Has the value of '0' so that numbers keep their
+     *  place relative to all other characters. */
+    const char DIGITS_MARKER = '0';
+    /** Replaces '/' so that "a/b" sorts before "a b" like paths do. */
+    const char SEPARATOR_CODE = '\x01';
+    /** Ends the natural part of the key. The original name follows. */
+    const char END_OF_NATURAL_PART = '\0';
+    /** The number of digits is stored in a single byte. */
+    const size_t MAX_DIGITS_LENGTH = 255;
+
+    bool isDigit (char c) {
+        return c >= '0' && c <= '9';
+    }
+}
+
+//==============================================================================
+//------------------------------ CollationKey ----------------------------------
+//==============================================================================
+CollationKey::CollationKey() {
+    _key.push_back(END_OF_NATURAL_PART);
+}
+CollationKey::CollationKey (const string& name) {
+    _key.reserve(2 * name.size() + 1);
+    size_t i = 0;
+    while (i < name.size()) {
+        char c = name[i];
+        if (isDigit(c)) {
+            size_t end = i;
+            while (end < name.size() && isDigit(name[end])) {
+                end++;
+            }
+            // Note: Leading zeros are skipped but a zero itself is kept.
+            while (i + 1 < end && name[i] == '0') {
+                i++;
+            }
+            size_t length = min (end - i, MAX_DIGITS_LENGTH);
+            _key.push_back(DIGITS_MARKER);
+            _key.push_back(static_cast<char>(length));
+            _key.append(name, i, length);
+            i = end;
+        } else {
+            if (c == '/') {
+                c = SEPARATOR_CODE;
+            } else if (c >= 'A' && c <= 'Z') {
+                c = c - 'A' + 'a';
+            }
+            _key.push_back(c);
+            i++;
+        }
+    }
+    _key.push_back(END_OF_NATURAL_PART);
+    _key.append(name);
+}
+CollationKey::CollationKey (const char* key, size_t length)
+: _key (key, length) {
+}
+const string& CollationKey::getKey() const {
+    return _key;
+}
+int CollationKey::compare (const char* key, size_t length) const {
+    return _key.compare(0, string::npos, key, length);
+}
+bool CollationKey::operator< (const CollationKey& other) const {
+    return _key < other._key;
+}
+bool CollationKey::operator== (const CollationKey& other) const {
+    return _key == other._key;
+}
+void CollationKey::sort (vector<string>& names) {
+    vector<pair<CollationKey, string>> keyedNames;
+    keyedNames.reserve(names.size());
+    for (string& name : names) {
+        keyedNames.emplace_back(CollationKey(name), std::move(name));
+    }
+    std::sort (keyedNames.begin(), keyedNames.end(),
+               [](const pair<CollationKey, string>& a,
+                  const pair<CollationKey, string>& b) {
+                   return a.first < b.first;
+               });
+    for (size_t i=0; i<names.size(); i++) {
+        names[i] = std::move(keyedNames[i].second);
+    }
+}
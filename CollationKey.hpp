@@ -0,0 +1,61 @@
+#ifndef COLLATION_KEY_HPP
+#define	COLLATION_KEY_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * Key for sorting names in natural order, e.g. "2.mp3" before "10.mp3". The
+ * key is computed once per name; afterwards keys are compared byte by byte.
+ * Runs of digits are encoded by their length followed by the digits without
+ * leading zeros, so they compare as numbers. ASCII letters are folded to
+ * lower case and '/' sorts before every other character so that paths are
+ * ordered directory by directory. Names that are equal apart from case and
+ * leading zeros are ordered by their original byte sequence, therefore
+ * different names never get equal keys.
+ */
+class CollationKey {
+public:
+    /**
+     * Constructor for the key of the empty name.
+     */
+    CollationKey();
+    /**
+     * Constructor.
+     * @param name The name the key is computed for.
+     */
+    explicit CollationKey (const std::string& name);
+    /**
+     * Constructor for a key that has been stored before.
+     * @param key The bytes as returned by getKey.
+     * @param length The number of bytes of the key.
+     */
+    CollationKey (const char* key, std::size_t length);
+    /**
+     * Get the encoded key.
+     * @return The bytes of the key.
+     */
+    const std::string& getKey() const;
+    /**
+     * Compare this key with the given stored key.
+     * @param key The bytes of the other key as returned by getKey.
+     * @param length The number of bytes of the other key.
+     * @return Less than, equal to or greater than zero if this key sorts
+     *         before, equal to or after the other key.
+     */
+    int compare (const char* key, std::size_t length) const;
+    bool operator< (const CollationKey& other) const;
+    bool operator== (const CollationKey& other) const;
+    /**
+     * Sort the given names in natural order. The key of each name is computed
+     * only once.
+     * @param names The names to be sorted.
+     */
+    static void sort (std::vector<std::string>& names);
+
+private:
+    std::string _key;
+};
+
+#endif	/* COLLATION_KEY_HPP */
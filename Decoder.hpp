@@ -0,0 +1,126 @@
+#ifndef DECODER_HPP
+#define	DECODER_HPP
+
+#include "Mpg123Parser.hpp"
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace boost {
+    namespace system {
+        class error_code;
+    }
+}
+class PcmOutput;
+
+/**
+ * Interface of the decoders the Mp3Player plays the titles with. The
+ * commands correspond to the commands of the remote control mode of mpg123
+ * (-R), the results are reported as the messages of mpg123 would be, e.g.
+ * the status of the current frame after each decoded frame. The decoders
+ * report to their listener in the io_service of the Mp3Player. The listener
+ * may be exchanged at any time, e.g. if the roles of two decoders are
+ * swapped.
+ */
+class Decoder {
+public:
+    /**
+     * Interface that has to be implemented by the receiver of the messages
+     * of a decoder.
+     */
+    class IListener : public virtual Mpg123Parser::IListener {
+    public:
+        /**
+         * Called if the communication with the decoder failed. No more
+         * messages are received after this call.
+         * @param error The error of the communication.
+         */
+        virtual void communicationProblem (
+                const boost::system::error_code& error) = 0;
+        /**
+         * Called if the decoder has terminated.
+         * @param waitpidStatus The status returned by waitpid.
+         */
+        virtual void terminated (int waitpidStatus) = 0;
+    };
+    /**
+     * Function that creates a decoder reporting to the given listener.
+     */
+    typedef std::function<std::unique_ptr<Decoder> (IListener& listener)>
+            Factory;
+    virtual ~Decoder() {}
+    /**
+     * Set the receiver of the messages.
+     * @param listener The new receiver of the messages.
+     */
+    virtual void setListener (IListener& listener) = 0;
+    /**
+     * Load the given title and start playing it (LOAD).
+     * @param path The path of the title.
+     */
+    virtual void load (const std::string& path) = 0;
+    /**
+     * Load the given title without playing it (LOADPAUSED). Playing is
+     * started by pause.
+     * @param path The path of the title.
+     */
+    virtual void loadPaused (const std::string& path) = 0;
+    /**
+     * Pause playing or continue it, if it is paused (PAUSE).
+     */
+    virtual void pause() = 0;
+    /**
+     * Stop playing and unload the title (STOP).
+     */
+    virtual void stop() = 0;
+    /**
+     * Jump to the given frame of the title (JUMP).
+     * @param frameCount The frame to jump to.
+     */
+    virtual void jumpTo (int frameCount) = 0;
+    /**
+     * Jump forward or backward by the given number of frames (JUMP +/-).
+     * @param frames The number of frames, negative to jump backward.
+     */
+    virtual void jumpBy (int frames) = 0;
+    /**
+     * Request the current sample and the sample count of the title (SAMPLE).
+     */
+    virtual void requestSample() = 0;
+    /**
+     * Stop reporting the status after each frame (SILENCE).
+     */
+    virtual void silence() = 0;
+    /**
+     * Replace the decoder by a new one, e.g. because it has terminated or
+     * does not respond any more. The listener is kept.
+     * @exception ChildProgram::CreationException Thrown if a decoder
+     *            running as child program could not be started.
+     */
+    virtual void restart() = 0;
+    /**
+     * Kill the decoder, if it runs as a child program. The listener is
+     * informed by terminated.
+     */
+    virtual void kill() = 0;
+    /**
+     * Tell whether the decoder has reported anything since it has been
+     * started. A decoder that terminates before is not able to run at all.
+     * @return True if the decoder has responded.
+     */
+    virtual bool hasResponded() const = 0;
+    /**
+     * Get the number of bytes of the error output of the decoder that have
+     * not been logged, due to the rate limit of the log.
+     * @return The number of bytes dropped.
+     */
+    virtual unsigned long getDroppedErrorByteCount() const = 0;
+    /**
+     * Get the output the decoder plays the audio by.
+     * @return The output, or nullptr if the decoder plays the audio itself.
+     */
+    virtual const PcmOutput* getOutput() const = 0;
+};
+
+#endif	/* DECODER_HPP */
+
@@ -0,0 +1,16 @@
+#include "FileSink.hpp"
+
+using std::size_t;
+using std::ostream;
+using std::shared_ptr;
+
+//==============================================================================
+//-------------------------------- FileSink ------------------------------------
+//==============================================================================
+FileSink::FileSink (const shared_ptr<ostream>& file)
+: _file (file) {
+}
+void FileSink::write (const char* data, size_t size) {
+    _file->write(data, size);
+    NullSink::write(data, size);
+}
@@ -0,0 +1,28 @@
+#ifndef FILE_SINK_HPP
+#define	FILE_SINK_HPP
+
+#include "NullSink.hpp"
+#include <memory>
+#include <ostream>
+
+/**
+ * Sink that writes the audio into a file, as fast as a device would play
+ * it. The file contains the raw samples of all titles, e.g. to check the
+ * output for gaps and glitches.
+ */
+class FileSink : public NullSink {
+public:
+    /**
+     * Constructor.
+     * @param file The file the audio is written to. It may be shared by the
+     *             sinks of several decoders, which play one after the other.
+     */
+    FileSink (const std::shared_ptr<std::ostream>& file);
+    void write (const char* data, std::size_t size) override;
+
+private:
+    std::shared_ptr<std::ostream> _file;
+};
+
+#endif	/* FILE_SINK_HPP */
+
@@ -0,0 +1,380 @@
+#include "Library.hpp"
+#include <boost/none.hpp>
+#include <algorithm>
+#include <cstring>
+
+using std::string;
+using std::vector;
+using std::size_t;
+using std::uint32_t;
+using std::uint8_t;
+using std::shared_ptr;
+using std::sort;
+using boost::optional;
+using boost::filesystem::path;
+
+//==============================================================================
+//--------------------------------- Library ------------------------------------
+//==============================================================================
+const size_t Library::BLOCK_SIZE (16);
+
+Library::Library()
+: _arenaSize (0)
+, _titleCount (0) {
+}
+Library::Library (const vector<LibraryScanner::Directory>& directories)
+: _arenaSize (0)
+, _titleCount (0) {
+    vector<AlbumSource> sources;
+    for (const LibraryScanner::Directory& directory : directories) {
+        if (!directory.files.empty()) {
+            sources.push_back(AlbumSource {directory.path,
+                                           CollationKey(directory.path.string()),
+                                           &directory, nullptr, 0});
+        }
+    }
+    sort (sources.begin(), sources.end(),
+          [](const AlbumSource& a, const AlbumSource& b) {
+              return a.key < b.key;
+          });
+    build(sources);
+}
+size_t Library::getAlbumCount() const {
+    return _albumRecords.size();
+}
+path Library::getAlbum (AlbumId album) const {
+    const AlbumRecord& record = _albumRecords[album];
+    return path(string(_arena.get() + record.pathOffset, record.pathLength));
+}
+optional<Library::AlbumId> Library::findAlbum (const path& album) const {
+    const CollationKey key (album.string());
+    AlbumId first = 0;
+    AlbumId count = _albumRecords.size();
+    while (count > 0) {
+        AlbumId step = count / 2;
+        if (compareAlbumKey(first + step, key) < 0) {
+            first += step + 1;
+            count -= step + 1;
+        } else {
+            count = step;
+        }
+    }
+    if (first < _albumRecords.size() && compareAlbumKey(first, key) == 0) {
+        return first;
+    }
+    return boost::none;
+}
+size_t Library::getTitleCount (AlbumId album) const {
+    return _albumRecords[album].titleCount;
+}
+size_t Library::getTitleCount() const {
+    return _titleCount;
+}
+string Library::getTitleName (AlbumId album, size_t title) const {
+    const AlbumRecord& record = _albumRecords[album];
+    const char* entry = _arena.get() +
+            _blockOffsets[record.firstBlock + title / BLOCK_SIZE];
+    string name;
+    for (size_t i = title % BLOCK_SIZE + 1; i > 0; i--) {
+        uint8_t prefixLength = entry[0];
+        uint8_t suffixLength = entry[1];
+        name.resize(prefixLength);
+        name.append(entry + 2, suffixLength);
+        entry += 2 + suffixLength;
+    }
+    return name;
+}
+path Library::getTitle (AlbumId album, size_t title) const {
+    return getAlbum(album) / getTitleName(album, title);
+}
+Library::TitleId Library::getTitleId (AlbumId album, size_t title) const {
+    return _albumRecords[album].firstTitle + title;
+}
+size_t Library::findTitle (AlbumId album, const string& name,
+                           bool* found) const {
+    const AlbumRecord& record = _albumRecords[album];
+    const CollationKey key (name);
+    size_t blockCount = (record.titleCount + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    // Find the last block whose first (completely stored) name does not sort
+    // after the given name.
+    size_t first = 0;
+    size_t count = blockCount;
+    while (count > 0) {
+        size_t step = count / 2;
+        const char* entry = _arena.get() +
+                _blockOffsets[record.firstBlock + first + step];
+        const CollationKey blockKey (string(entry + 2,
+                static_cast<uint8_t>(entry[1])));
+        if (!(key < blockKey)) {
+            first += step + 1;
+            count -= step + 1;
+        } else {
+            count = step;
+        }
+    }
+    size_t title = 0;
+    if (first > 0) {
+        title = (first - 1) * BLOCK_SIZE;
+        size_t blockEnd = std::min (title + BLOCK_SIZE,
+                                    static_cast<size_t>(record.titleCount));
+        const char* entry = _arena.get() +
+                _blockOffsets[record.firstBlock + first - 1];
+        string current;
+        for (; title < blockEnd; title++) {
+            uint8_t prefixLength = entry[0];
+            uint8_t suffixLength = entry[1];
+            current.resize(prefixLength);
+            current.append(entry + 2, suffixLength);
+            entry += 2 + suffixLength;
+            const CollationKey currentKey (current);
+            if (!(currentKey < key)) {
+                if (found != nullptr) {
+                    *found = (currentKey == key);
+                }
+                return title;
+            }
+        }
+    }
+    if (found != nullptr) {
+        *found = false;
+    }
+    return title;
+}
+Mp3Duration Library::getTitleDuration (AlbumId album, size_t title) const {
+    const AlbumRecord& record = _albumRecords[album];
+    Mp3Duration end = getTitleEnd(record, title);
+    Mp3Duration start = getTitleStart(album, title);
+    return Mp3Duration(end.getFrameCount() - start.getFrameCount(),
+                       end.getMilliseconds() - start.getMilliseconds());
+}
+Mp3Duration Library::getAlbumDuration (AlbumId album) const {
+    const AlbumRecord& record = _albumRecords[album];
+    if (record.titleCount == 0) {
+        return Mp3Duration();
+    }
+    return getTitleEnd(record, record.titleCount - 1);
+}
+Mp3Duration Library::getTitleStart (AlbumId album, size_t title) const {
+    if (title == 0) {
+        return Mp3Duration();
+    }
+    return getTitleEnd(_albumRecords[album], title - 1);
+}
+size_t Library::findTitleAtTime (AlbumId album, uint32_t milliseconds) const {
+    const AlbumRecord& record = _albumRecords[album];
+    auto first = _titleEndMilliseconds.begin() + record.firstTitle;
+    return std::upper_bound(first, first + record.titleCount, milliseconds) -
+           first;
+}
+size_t Library::findTitleAtFrame (AlbumId album, uint32_t frameCount) const {
+    const AlbumRecord& record = _albumRecords[album];
+    auto first = _titleEndFrameCounts.begin() + record.firstTitle;
+    return std::upper_bound(first, first + record.titleCount, frameCount) -
+           first;
+}
+shared_ptr<const Library> Library::update (const AlbumMap& changedAlbums,
+        const vector<path>& removedDirectories) const {
+    vector<AlbumSource> sources;
+    sources.reserve(_albumRecords.size() + changedAlbums.size());
+    for (AlbumId album=0; album<_albumRecords.size(); album++) {
+        path albumPath = getAlbum(album);
+        // Note: Changed albums are replaced by their new content.
+        bool removed = changedAlbums.count(albumPath) != 0;
+        for (auto it = removedDirectories.begin();
+             !removed && it != removedDirectories.end(); ++it) {
+            removed = isInside(albumPath, *it);
+        }
+        if (!removed) {
+            sources.push_back(AlbumSource {albumPath, getAlbumKey(album),
+                                           nullptr, this, album});
+        }
+    }
+    for (const auto& albumMapping : changedAlbums) {
+        if (!albumMapping.second.files.empty()) {
+            sources.push_back(AlbumSource {albumMapping.first,
+                    CollationKey(albumMapping.first.string()),
+                    &albumMapping.second, nullptr, 0});
+        }
+    }
+    sort (sources.begin(), sources.end(),
+          [](const AlbumSource& a, const AlbumSource& b) {
+              return a.key < b.key;
+          });
+    shared_ptr<Library> library = std::make_shared<Library>();
+    library->build(sources);
+    return library;
+}
+shared_ptr<const Library> Library::merge (
+        const vector<shared_ptr<const Library>>& libraries) {
+    vector<AlbumSource> sources;
+    for (const shared_ptr<const Library>& library : libraries) {
+        if (!library) {
+            continue;
+        }
+        for (AlbumId album=0; album<library->getAlbumCount(); album++) {
+            sources.push_back(AlbumSource {library->getAlbum(album),
+                    library->getAlbumKey(album), nullptr, library.get(),
+                    album});
+        }
+    }
+    sort (sources.begin(), sources.end(),
+          [](const AlbumSource& a, const AlbumSource& b) {
+              return a.key < b.key;
+          });
+    shared_ptr<Library> library = std::make_shared<Library>();
+    library->build(sources);
+    return library;
+}
+bool Library::isInside (const path& file, const path& directory) {
+    const string& fileName = file.string();
+    const string& directoryName = directory.string();
+    if (fileName.compare(0, directoryName.size(), directoryName) != 0) {
+        return false;
+    }
+    return fileName.size() == directoryName.size() ||
+           fileName[directoryName.size()] == '/';
+}
+void Library::build (const vector<AlbumSource>& sources) {
+    // Note: File names are limited to 255 bytes (NAME_MAX), therefore the
+    // lengths of the common prefix and of the suffix fit into one byte each.
+    auto prefixLength = [](const NameList& names, size_t i) -> size_t {
+        if (i % BLOCK_SIZE == 0) {
+            return 0;
+        }
+        const string& previous = names[i-1];
+        const string& current = names[i];
+        size_t length = 0;
+        size_t maxLength = std::min (previous.size(), current.size());
+        while (length < maxLength && previous[length] == current[length]) {
+            length++;
+        }
+        return length;
+    };
+    // First pass: Determine the size of the arena so that it is allocated
+    // only once.
+    size_t arenaSize = 0;
+    size_t titleCount = 0;
+    size_t blockCount = 0;
+    for (const AlbumSource& source : sources) {
+        arenaSize += source.path.string().size() +
+                source.key.getKey().size();
+        size_t albumTitleCount;
+        if (source.directory != nullptr) {
+            const NameList& names = source.directory->files;
+            albumTitleCount = names.size();
+            for (size_t i=0; i<albumTitleCount; i++) {
+                arenaSize += 2 + names[i].size() - prefixLength(names, i);
+            }
+        } else {
+            const AlbumRecord& record =
+                    source.library->_albumRecords[source.album];
+            albumTitleCount = record.titleCount;
+            arenaSize += record.titlesLength;
+        }
+        titleCount += albumTitleCount;
+        blockCount += (albumTitleCount + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    }
+    _arena.reset(new char[arenaSize]);
+    _arenaSize = arenaSize;
+    _titleCount = titleCount;
+    _albumRecords.clear();
+    _albumRecords.reserve(sources.size());
+    _blockOffsets.clear();
+    _blockOffsets.reserve(blockCount);
+    _titleEndFrameCounts.clear();
+    _titleEndFrameCounts.reserve(titleCount);
+    _titleEndMilliseconds.clear();
+    _titleEndMilliseconds.reserve(titleCount);
+    // Second pass: Fill the arena.
+    char* arena = _arena.get();
+    uint32_t offset = 0;
+    uint32_t firstTitle = 0;
+    for (const AlbumSource& source : sources) {
+        const string& albumPath = source.path.string();
+        const string& albumKey = source.key.getKey();
+        AlbumRecord record;
+        record.pathOffset = offset;
+        record.pathLength = albumPath.size();
+        record.keyLength = albumKey.size();
+        record.firstTitle = firstTitle;
+        record.firstBlock = _blockOffsets.size();
+        memcpy(arena + offset, albumPath.data(), albumPath.size());
+        offset += albumPath.size();
+        memcpy(arena + offset, albumKey.data(), albumKey.size());
+        offset += albumKey.size();
+        uint32_t titlesOffset = offset;
+        if (source.directory != nullptr) {
+            const NameList& names = source.directory->files;
+            const vector<Mp3Duration>& durations = source.directory->durations;
+            record.titleCount = names.size();
+            uint32_t frameCount = 0;
+            uint32_t milliseconds = 0;
+            for (size_t i=0; i<names.size(); i++) {
+                if (i < durations.size()) {
+                    frameCount += durations[i].getFrameCount();
+                    milliseconds += durations[i].getMilliseconds();
+                }
+                _titleEndFrameCounts.push_back(frameCount);
+                _titleEndMilliseconds.push_back(milliseconds);
+            }
+            for (size_t i=0; i<names.size(); i++) {
+                if (i % BLOCK_SIZE == 0) {
+                    _blockOffsets.push_back(offset);
+                }
+                size_t prefix = prefixLength(names, i);
+                size_t suffix = names[i].size() - prefix;
+                arena[offset] = static_cast<char>(prefix);
+                arena[offset + 1] = static_cast<char>(suffix);
+                memcpy(arena + offset + 2, names[i].data() + prefix, suffix);
+                offset += 2 + suffix;
+            }
+        } else {
+            // Note: The encoded titles of an unchanged album are copied as
+            // they are. Only the block offsets have to be moved.
+            const Library* from = source.library;
+            const AlbumRecord& fromRecord = from->_albumRecords[source.album];
+            record.titleCount = fromRecord.titleCount;
+            auto fromFrameCounts = from->_titleEndFrameCounts.begin() +
+                    fromRecord.firstTitle;
+            _titleEndFrameCounts.insert(_titleEndFrameCounts.end(),
+                    fromFrameCounts, fromFrameCounts + fromRecord.titleCount);
+            auto fromMilliseconds = from->_titleEndMilliseconds.begin() +
+                    fromRecord.firstTitle;
+            _titleEndMilliseconds.insert(_titleEndMilliseconds.end(),
+                    fromMilliseconds, fromMilliseconds + fromRecord.titleCount);
+            memcpy(arena + offset, from->getTitles(fromRecord),
+                   fromRecord.titlesLength);
+            uint32_t fromOffset = from->getTitles(fromRecord) -
+                    from->_arena.get();
+            size_t fromBlockCount = (fromRecord.titleCount + BLOCK_SIZE - 1) /
+                    BLOCK_SIZE;
+            for (size_t i=0; i<fromBlockCount; i++) {
+                _blockOffsets.push_back(offset - fromOffset +
+                        from->_blockOffsets[fromRecord.firstBlock + i]);
+            }
+            offset += fromRecord.titlesLength;
+        }
+        record.titlesLength = offset - titlesOffset;
+        firstTitle += record.titleCount;
+        _albumRecords.push_back(record);
+    }
+}
+CollationKey Library::getAlbumKey (AlbumId album) const {
+    const AlbumRecord& record = _albumRecords[album];
+    return CollationKey(_arena.get() + record.pathOffset + record.pathLength,
+                        record.keyLength);
+}
+int Library::compareAlbumKey (AlbumId album, const CollationKey& key) const {
+    const AlbumRecord& record = _albumRecords[album];
+    return -key.compare(_arena.get() + record.pathOffset + record.pathLength,
+                        record.keyLength);
+}
+const char* Library::getTitles (const AlbumRecord& record) const {
+    return _arena.get() + record.pathOffset + record.pathLength +
+           record.keyLength;
+}
+Mp3Duration Library::getTitleEnd (const AlbumRecord& record,
+                                  size_t title) const {
+    return Mp3Duration(_titleEndFrameCounts[record.firstTitle + title],
+                       _titleEndMilliseconds[record.firstTitle + title]);
+}
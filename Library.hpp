@@ -0,0 +1,246 @@
+#ifndef LIBRARY_HPP
+#define	LIBRARY_HPP
+
+#include "CollationKey.hpp"
+#include "LibraryScanner.hpp"
+#include "Mp3Duration.hpp"
+#include <boost/filesystem/path.hpp>
+#include <boost/optional.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * Immutable snapshot of the albums and their titles. A changed library is
+ * published as a new snapshot, so a snapshot can be used without locking
+ * while the next one is built in the background.
+ * The snapshot is stored compactly in a single arena: The path of each album
+ * directory is stored once, the file names of its titles are front-coded
+ * (each name only stores the part that differs from the previous name). Every
+ * BLOCK_SIZE titles a name is stored completely so that a title can be found
+ * without decoding the whole album. Full paths are only built on request.
+ * Albums and titles are sorted in natural order. The collation key of each
+ * album is stored next to its path, so re-sorting the albums after an update
+ * compares the stored keys instead of computing them again.
+ * Albums and titles are addressed by their index. Additionally each title
+ * has a dense ID over all albums that can be used to index per-title tables.
+ * The durations and frame counts of the titles are stored as prefix sums per
+ * album, so the title playing at a given time of the album is found with a
+ * binary search. Titles whose duration is unknown have a duration of zero.
+ */
+class Library {
+public:
+    typedef boost::filesystem::path Path;
+    typedef std::uint32_t AlbumId;
+    typedef std::uint32_t TitleId;
+    typedef std::vector<std::string> NameList;
+    typedef std::map<Path, LibraryScanner::Directory> AlbumMap;
+    /**
+     * Constructor for an empty library.
+     */
+    Library();
+    /**
+     * Constructor. Takes all directories containing at least one mp3 file as
+     * album.
+     * @param directories The directories found by a LibraryScanner.
+     */
+    Library (const std::vector<LibraryScanner::Directory>& directories);
+    Library (const Library&) = delete;
+    Library& operator= (const Library&) = delete;
+    /**
+     * Get the number of albums.
+     * @return The number of albums. The albums are numbered from zero.
+     */
+    std::size_t getAlbumCount() const;
+    /**
+     * Get the directory of the given album.
+     * @param album The number of the album.
+     * @return The album directory.
+     */
+    Path getAlbum (AlbumId album) const;
+    /**
+     * Find the album with the given directory.
+     * @param album The album directory.
+     * @return The number of the album or none if there is no such album.
+     */
+    boost::optional<AlbumId> findAlbum (const Path& album) const;
+    /**
+     * Get the number of titles of the given album.
+     * @param album The number of the album.
+     * @return The number of titles. The titles are numbered from zero.
+     */
+    std::size_t getTitleCount (AlbumId album) const;
+    /**
+     * Get the number of titles of all albums.
+     * @return The total number of titles.
+     */
+    std::size_t getTitleCount() const;
+    /**
+     * Get the file name of the given title.
+     * @param album The number of the album.
+     * @param title The number of the title within the album.
+     * @return The file name of the title.
+     */
+    std::string getTitleName (AlbumId album, std::size_t title) const;
+    /**
+     * Get the full path of the given title.
+     * @param album The number of the album.
+     * @param title The number of the title within the album.
+     * @return The path of the mp3 file.
+     */
+    Path getTitle (AlbumId album, std::size_t title) const;
+    /**
+     * Get the ID of the given title. The titles of all albums are numbered
+     * consecutively in the order of the albums, starting with zero.
+     * @param album The number of the album.
+     * @param title The number of the title within the album.
+     * @return The ID of the title, less than getTitleCount().
+     */
+    TitleId getTitleId (AlbumId album, std::size_t title) const;
+    /**
+     * Find the title with the given file name.
+     * @param album The number of the album.
+     * @param name The file name of the title.
+     * @param found Optionally set to true if the title exists, else false.
+     * @return The number of the title. If there is no such title the number
+     *         of the first title after the given name.
+     */
+    std::size_t findTitle (AlbumId album, const std::string& name,
+                           bool* found = nullptr) const;
+    /**
+     * Get the duration of the given title.
+     * @param album The number of the album.
+     * @param title The number of the title within the album.
+     * @return The duration of the title. Unknown if it could not be
+     *         determined.
+     */
+    Mp3Duration getTitleDuration (AlbumId album, std::size_t title) const;
+    /**
+     * Get the duration of all titles of the given album.
+     * @param album The number of the album.
+     * @return The sum of the durations of the titles.
+     */
+    Mp3Duration getAlbumDuration (AlbumId album) const;
+    /**
+     * Get the time at which the given title starts if the album is played
+     * from its beginning.
+     * @param album The number of the album.
+     * @param title The number of the title within the album.
+     * @return The sum of the durations of the titles before the given title.
+     */
+    Mp3Duration getTitleStart (AlbumId album, std::size_t title) const;
+    /**
+     * Find the title that is played at the given time if the album is played
+     * from its beginning.
+     * @param album The number of the album.
+     * @param milliseconds The time since the beginning of the album.
+     * @return The number of the title. If the time is beyond the end of the
+     *         album the number of titles.
+     */
+    std::size_t findTitleAtTime (AlbumId album,
+                                 std::uint32_t milliseconds) const;
+    /**
+     * Find the title that contains the given frame if the frames of the
+     * album are counted from its beginning.
+     * @param album The number of the album.
+     * @param frameCount The number of frames since the beginning of the
+     *                   album.
+     * @return The number of the title. If the frame is beyond the end of the
+     *         album the number of titles.
+     */
+    std::size_t findTitleAtFrame (AlbumId album,
+                                  std::uint32_t frameCount) const;
+    /**
+     * Create a new snapshot that contains the given changes.
+     * @param changedAlbums Albums that have been added or whose titles have
+     *                      changed, as read by the LibraryScanner. An album
+     *                      without titles is removed.
+     * @param removedDirectories Directories that have been removed. All
+     *                           albums in and below these directories are
+     *                           removed.
+     * @return The new snapshot. This snapshot remains unchanged.
+     */
+    std::shared_ptr<const Library> update (const AlbumMap& changedAlbums,
+            const std::vector<Path>& removedDirectories) const;
+    /**
+     * Create a snapshot that contains the albums of all given snapshots. The
+     * encoded titles are copied as they are, so merging is cheap compared to
+     * building the snapshots.
+     * @param libraries The snapshots to be merged. They must not contain the
+     *                  same album. Null pointers are skipped.
+     * @return The merged snapshot.
+     */
+    static std::shared_ptr<const Library> merge (
+            const std::vector<std::shared_ptr<const Library>>& libraries);
+    /**
+     * Check if the given path is the given directory or is located below it.
+     * @param file The path to be checked.
+     * @param directory The directory.
+     * @return True if file is inside directory.
+     */
+    static bool isInside (const Path& file, const Path& directory);
+
+protected:
+    /**
+     * The location of an album and its titles in the arena.
+     */
+    struct AlbumRecord {
+        std::uint32_t pathOffset;
+        std::uint32_t pathLength;
+        std::uint32_t keyLength;
+        std::uint32_t titlesLength;
+        std::uint32_t firstTitle;
+        std::uint32_t titleCount;
+        std::uint32_t firstBlock;
+    };
+    /**
+     * An album that is added to a library being built. The titles are either
+     * given by a scanned directory or copied from the album of another
+     * library.
+     */
+    struct AlbumSource {
+        Path path;
+        CollationKey key;
+        const LibraryScanner::Directory* directory;
+        const Library* library;
+        AlbumId album;
+    };
+    /**
+     * Fill this library with the given albums.
+     * @param sources The albums sorted by their collation key.
+     */
+    void build (const std::vector<AlbumSource>& sources);
+    /**
+     * Get the collation key of the given album.
+     */
+    CollationKey getAlbumKey (AlbumId album) const;
+    /**
+     * Compare the collation key of the given album with the given key.
+     */
+    int compareAlbumKey (AlbumId album, const CollationKey& key) const;
+    /**
+     * Get the begin of the front-coded names of the given album.
+     */
+    const char* getTitles (const AlbumRecord& record) const;
+    /**
+     * Get the duration of the given album from its beginning up to and
+     * including the given title.
+     */
+    Mp3Duration getTitleEnd (const AlbumRecord& record,
+                             std::size_t title) const;
+
+private:
+    std::vector<AlbumRecord> _albumRecords;
+    std::vector<std::uint32_t> _blockOffsets;
+    std::vector<std::uint32_t> _titleEndFrameCounts;
+    std::vector<std::uint32_t> _titleEndMilliseconds;
+    std::unique_ptr<char[]> _arena;
+    std::size_t _arenaSize;
+    std::size_t _titleCount;
+    static const std::size_t BLOCK_SIZE;
+};
+
+#endif	/* LIBRARY_HPP */
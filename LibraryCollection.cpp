@@ -0,0 +1,117 @@
+#include "LibraryCollection.hpp"
+#include <iostream>
+
+using std::vector;
+using std::shared_ptr;
+using std::cout;
+using std::endl;
+using boost::asio::io_service;
+using boost::filesystem::path;
+
+//==============================================================================
+//---------------------------- LibraryCollection -------------------------------
+//==============================================================================
+LibraryCollection::LibraryCollection (const path& albumsPath,
+                                      const path& volumesPath,
+                                      io_service& ioService)
+: _ioService (ioService)
+, _albumsPath (albumsPath)
+, _complete (false) {
+    _roots[albumsPath].reset(new Root(*this, albumsPath, ioService, false));
+    watchVolumes(volumesPath);
+}
+LibraryCollection::LibraryCollection (const shared_ptr<const Library>& library,
+        const vector<LibraryScanner::Directory>& directories,
+        const path& volumesPath, io_service& ioService)
+: _ioService (ioService)
+, _complete (false) {
+    for (const LibraryScanner::Directory& directory : directories) {
+        if (directory.relativePath.empty()) {
+            _albumsPath = directory.path;
+        }
+    }
+    _roots[_albumsPath].reset(new Root(*this, library, directories,
+                                       ioService));
+    watchVolumes(volumesPath);
+}
+void LibraryCollection::addListener (IListener* listener) {
+    _listeners.push_back(listener);
+}
+void LibraryCollection::volumeMounted (const path& mountPoint) {
+    // Note: A volume that contains the albums directory or is located in it
+    // is already part of the collection.
+    if (Library::isInside(_albumsPath, mountPoint) ||
+        Library::isInside(mountPoint, _albumsPath)) {
+        return;
+    }
+    _roots[mountPoint].reset(new Root(*this, mountPoint, _ioService, true));
+}
+void LibraryCollection::volumeUnmounted (const path& mountPoint) {
+    if (_roots.erase(mountPoint) > 0) {
+        shardChanged();
+    }
+}
+void LibraryCollection::watchVolumes (const path& volumesPath) {
+    if (volumesPath.empty()) {
+        return;
+    }
+    _mountWatcher.reset(new MountWatcher(volumesPath, _ioService));
+    _mountWatcher->addListener(this);
+    for (const path& mountPoint : _mountWatcher->getMountPoints()) {
+        volumeMounted(mountPoint);
+    }
+}
+void LibraryCollection::shardChanged() {
+    vector<shared_ptr<const Library>> shards;
+    shards.reserve(_roots.size());
+    for (const auto& root : _roots) {
+        const shared_ptr<const Library>& shard = root.second->getShard();
+        if (!shard) {
+            // Note: The first library is handed over when all roots known
+            // from the beginning have been scanned. Volumes mounted later
+            // on are added as soon as they have been scanned.
+            if (!_complete) {
+                return;
+            }
+            continue;
+        }
+        shards.push_back(shard);
+    }
+    _complete = true;
+    shared_ptr<const Library> library = (shards.size() == 1) ? shards[0] :
+            Library::merge(shards);
+    if (shards.size() > 1) {
+        cout << "Library contains " << library->getAlbumCount()
+             << " albums of " << shards.size() << " roots." << endl;
+    }
+    for (auto l : _listeners) {
+        l->libraryChanged(library);
+    }
+}
+//==============================================================================
+//------------------------- LibraryCollection::Root ----------------------------
+//==============================================================================
+LibraryCollection::Root::Root (LibraryCollection& collection,
+                               const path& rootPath, io_service& ioService,
+                               bool lowPriority)
+: _collection (collection)
+, _watcher (new LibraryWatcher(rootPath, ioService, lowPriority)) {
+    _watcher->addListener(this);
+}
+LibraryCollection::Root::Root (LibraryCollection& collection,
+        const shared_ptr<const Library>& library,
+        const vector<LibraryScanner::Directory>& directories,
+        io_service& ioService)
+: _collection (collection)
+, _shard (library)
+, _watcher (new LibraryWatcher(library, directories, ioService)) {
+    _watcher->addListener(this);
+}
+const shared_ptr<const Library>& LibraryCollection::Root::getShard() const {
+    return _shard;
+}
+void LibraryCollection::Root::libraryChanged (
+        const shared_ptr<const Library>& library) {
+    _shard = library;
+    _collection.shardChanged();
+}
@@ -0,0 +1,155 @@
+#ifndef LIBRARY_COLLECTION_HPP
+#define	LIBRARY_COLLECTION_HPP
+
+#include "Library.hpp"
+#include "LibraryScanner.hpp"
+#include "LibraryWatcher.hpp"
+#include "MountWatcher.hpp"
+#include <boost/filesystem/path.hpp>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace boost {
+    namespace asio {
+        class io_service;
+    }
+}
+
+/**
+ * Class that combines the albums of several directories (roots) into one
+ * library: The albums directory given on the command line and the volumes
+ * (e.g. USB sticks) mounted below the volumes directory. Each root is
+ * scanned and watched by a LibraryWatcher of its own and has its own library
+ * snapshot (shard). Whenever a shard changes the shards are merged into a new
+ * library snapshot, which is cheap since the encoded titles are just copied.
+ * Volumes mounted while playing are scanned in the background with low
+ * priority. The albums of an unmounted volume are removed.
+ */
+class LibraryCollection : public virtual MountWatcher::IListener {
+public:
+    typedef boost::filesystem::path Path;
+    /**
+     * Interface that has to be implemented by listeners on library changes.
+     * The listeners are called in the context of the boost asio io_service.
+     */
+    class IListener {
+    public:
+        /**
+         * Virtual destructor.
+         */
+        virtual ~IListener() {}
+        /**
+         * Called when a new library snapshot has been built. The first
+         * snapshot is handed over as soon as all roots known at construction
+         * time have been scanned.
+         * @param library The new library snapshot containing all roots.
+         */
+        virtual void libraryChanged (
+                const std::shared_ptr<const Library>& library) = 0;
+    };
+    /**
+     * Constructor. Scans the albums directory and the volumes that are
+     * already mounted in the background.
+     * @param albumsPath The directory containing the albums.
+     * @param volumesPath The directory below which volumes are mounted. If
+     *                    empty no volumes are added.
+     * @param ioService The io_service used as the context for calling the
+     *                  listeners.
+     */
+    LibraryCollection (const Path& albumsPath, const Path& volumesPath,
+                       boost::asio::io_service& ioService);
+    /**
+     * Constructor for an albums directory that has been scanned already. The
+     * volumes that are already mounted are scanned in the background.
+     * @param library The library of the albums directory.
+     * @param directories All directories of the albums directory.
+     * @param volumesPath The directory below which volumes are mounted. If
+     *                    empty no volumes are added.
+     * @param ioService The io_service used as the context for calling the
+     *                  listeners.
+     */
+    LibraryCollection (const std::shared_ptr<const Library>& library,
+            const std::vector<LibraryScanner::Directory>& directories,
+            const Path& volumesPath, boost::asio::io_service& ioService);
+    LibraryCollection (const LibraryCollection&) = delete;
+    LibraryCollection& operator= (const LibraryCollection&) = delete;
+    /**
+     * Add a listener that is called when the library has changed. Has to be
+     * called in the context of the io_service.
+     * @param listener The listener to be added.
+     */
+    void addListener (IListener* listener);
+    /**
+     * @see MountWatcher#IListener#volumeMounted
+     */
+    void volumeMounted (const Path& mountPoint) override;
+    /**
+     * @see MountWatcher#IListener#volumeUnmounted
+     */
+    void volumeUnmounted (const Path& mountPoint) override;
+
+protected:
+    /**
+     * A directory whose albums are part of the collection.
+     */
+    class Root : public virtual LibraryWatcher::IListener {
+    public:
+        /**
+         * Constructor. Scans the given directory in the background.
+         * @param collection The collection the root belongs to.
+         * @param rootPath The directory containing the albums.
+         * @param ioService The io_service used by the collection.
+         * @param lowPriority True to scan with low priority.
+         */
+        Root (LibraryCollection& collection, const Path& rootPath,
+              boost::asio::io_service& ioService, bool lowPriority);
+        /**
+         * Constructor for a directory that has been scanned already.
+         * @param collection The collection the root belongs to.
+         * @param library The library of the directory.
+         * @param directories All directories below the directory.
+         * @param ioService The io_service used by the collection.
+         */
+        Root (LibraryCollection& collection,
+              const std::shared_ptr<const Library>& library,
+              const std::vector<LibraryScanner::Directory>& directories,
+              boost::asio::io_service& ioService);
+        /**
+         * Get the library of this root.
+         * @return The library or null if the directory has not been scanned
+         *         yet.
+         */
+        const std::shared_ptr<const Library>& getShard() const;
+        /**
+         * @see LibraryWatcher#IListener#libraryChanged
+         */
+        void libraryChanged (
+                const std::shared_ptr<const Library>& library) override;
+    private:
+        LibraryCollection& _collection;
+        std::shared_ptr<const Library> _shard;
+        std::unique_ptr<LibraryWatcher> _watcher;
+    };
+    /**
+     * Start watching the mounted volumes and add the volumes that are
+     * mounted already.
+     * @param volumesPath The directory below which volumes are mounted.
+     */
+    void watchVolumes (const Path& volumesPath);
+    /**
+     * Merge the shards of all roots and hand the result over to the
+     * listeners.
+     */
+    void shardChanged();
+
+private:
+    boost::asio::io_service& _ioService;
+    Path _albumsPath;
+    std::vector<IListener*> _listeners;
+    std::map<Path, std::unique_ptr<Root>> _roots;
+    std::unique_ptr<MountWatcher> _mountWatcher;
+    bool _complete;
+};
+
+#endif	/* LIBRARY_COLLECTION_HPP */
@@ -0,0 +1,284 @@
+#include "LibraryIndex.hpp"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+using std::string;
+using std::vector;
+using std::ofstream;
+using std::cerr;
+using std::endl;
+using std::int64_t;
+using std::uint32_t;
+using boost::filesystem::path;
+
+namespace {
+    const char INDEX_MAGIC[8] = {'S', 'E', 'M', 'P', '3', 'I', 'D', 'X'};
+    /** Version 2: The names are sorted in natural order.
+     *  Version 3: The durations of the files are stored. */
+    const uint32_t INDEX_VERSION = 3;
+    /** Start of the index file. */
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t serialNumber;
+        uint32_t directoryCount;
+        uint32_t nameCount;
+        uint32_t stringsSize;
+        uint32_t reserved;
+    };
+    /** One record per directory follows the header. The names of the files
+     *  come first, the names of the sub-directories afterwards. */
+    struct DirectoryRecord {
+        int64_t modificationTime;
+        uint32_t pathOffset;
+        uint32_t pathLength;
+        uint32_t firstName;
+        uint32_t fileCount;
+        uint32_t subdirectoryCount;
+        uint32_t reserved;
+    };
+    /** The name records follow the directory records, the strings follow the
+     *  name records. The file ends with a trailer that repeats the serial
+     *  number to detect files that have not been written completely. The
+     *  duration of a sub-directory is zero. */
+    struct NameRecord {
+        uint32_t offset;
+        uint32_t length;
+        uint32_t frameCount;
+        uint32_t milliseconds;
+    };
+    struct Trailer {
+        uint32_t serialNumber;
+        uint32_t reserved;
+    };
+    const DirectoryRecord* directoryRecords (const char* image) {
+        return reinterpret_cast<const DirectoryRecord*>(image + sizeof(Header));
+    }
+    const NameRecord* nameRecords (const char* image) {
+        const Header* header = reinterpret_cast<const Header*>(image);
+        return reinterpret_cast<const NameRecord*>(image + sizeof(Header) +
+                header->directoryCount * sizeof(DirectoryRecord));
+    }
+    const char* strings (const char* image) {
+        const Header* header = reinterpret_cast<const Header*>(image);
+        return reinterpret_cast<const char*>(nameRecords(image) +
+                header->nameCount);
+    }
+}
+
+//==============================================================================
+//------------------------------ LibraryIndex ----------------------------------
+//==============================================================================
+const string LibraryIndex::BASE_FILENAME ("library.idx");
+const string LibraryIndex::ODD_PREFIX ("a-");
+const string LibraryIndex::EVEN_PREFIX ("b-");
+
+LibraryIndex::LibraryIndex (const path& albumsPath)
+: _albumsPath (albumsPath)
+, _image (nullptr)
+, _imageSize (0)
+, _serialNumber (0) {
+    uint32_t oddSerialNumber = 0;
+    if (map(ODD_PREFIX)) {
+        oddSerialNumber = _serialNumber;
+    }
+    uint32_t evenSerialNumber = 0;
+    if (map(EVEN_PREFIX)) {
+        evenSerialNumber = _serialNumber;
+    }
+    // Note: After UINT_MAX the serial number wraps around to 2, therefore a
+    // small even number is newer than a big odd one.
+    bool useOdd = oddSerialNumber > evenSerialNumber;
+    if (oddSerialNumber == UINT_MAX && evenSerialNumber != 0) {
+        useOdd = false;
+    }
+    if (useOdd) {
+        map(ODD_PREFIX);
+    } else if (evenSerialNumber == 0) {
+        unmap();
+        return;
+    }
+    const Header* header = reinterpret_cast<const Header*>(_image);
+    const DirectoryRecord* records = directoryRecords(_image);
+    const char* names = strings(_image);
+    _directoryRecords.reserve(header->directoryCount);
+    for (uint32_t i=0; i<header->directoryCount; i++) {
+        _directoryRecords.emplace (string(names + records[i].pathOffset,
+                                          records[i].pathLength), i);
+    }
+}
+LibraryIndex::~LibraryIndex() {
+    unmap();
+}
+vector<LibraryScanner::Directory> LibraryIndex::scan (
+        unsigned int threadCount) {
+    LibraryScanner scanner (threadCount);
+    vector<Directory> directories = scanner.scan(_albumsPath, this);
+    if (_image == nullptr || scanner.getDirectoriesRead() > 0 ||
+        directories.size() != _directoryRecords.size()) {
+        write(directories);
+    }
+    return directories;
+}
+bool LibraryIndex::findDirectory (Directory& directory) const {
+    auto itRecord = _directoryRecords.find(directory.relativePath);
+    if (itRecord == _directoryRecords.end()) {
+        return false;
+    }
+    const DirectoryRecord& record = directoryRecords(_image)[itRecord->second];
+    if (record.modificationTime != directory.modificationTime) {
+        return false;
+    }
+    const NameRecord* nameRecord = nameRecords(_image) + record.firstName;
+    const char* names = strings(_image);
+    directory.files.reserve(record.fileCount);
+    directory.durations.reserve(record.fileCount);
+    for (uint32_t i=0; i<record.fileCount; i++, nameRecord++) {
+        directory.files.emplace_back(names + nameRecord->offset,
+                                     nameRecord->length);
+        directory.durations.emplace_back(nameRecord->frameCount,
+                                         nameRecord->milliseconds);
+    }
+    directory.subdirectories.reserve(record.subdirectoryCount);
+    for (uint32_t i=0; i<record.subdirectoryCount; i++, nameRecord++) {
+        directory.subdirectories.emplace_back(names + nameRecord->offset,
+                                              nameRecord->length);
+    }
+    return true;
+}
+bool LibraryIndex::map (const string& prefix) {
+    unmap();
+    path fileName (_albumsPath);
+    fileName /= prefix + BASE_FILENAME;
+    int fd = open(fileName.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0 || status.st_size <
+            static_cast<off_t>(sizeof(Header) + sizeof(Trailer))) {
+        close(fd);
+        return false;
+    }
+    void* image = mmap(nullptr, status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (image == MAP_FAILED) {
+        return false;
+    }
+    _image = static_cast<const char*>(image);
+    _imageSize = status.st_size;
+    const Header* header = reinterpret_cast<const Header*>(_image);
+    uint64_t expectedSize = sizeof(Header) +
+            static_cast<uint64_t>(header->directoryCount) *
+                    sizeof(DirectoryRecord) +
+            static_cast<uint64_t>(header->nameCount) * sizeof(NameRecord) +
+            header->stringsSize + sizeof(Trailer);
+    // Note: The trailer follows the strings and therefore may not be aligned.
+    Trailer trailer;
+    memcpy(&trailer, _image + _imageSize - sizeof(Trailer), sizeof(Trailer));
+    if (memcmp(header->magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0 ||
+        header->version != INDEX_VERSION || expectedSize != _imageSize ||
+        trailer.serialNumber != header->serialNumber) {
+        unmap();
+        return false;
+    }
+    const DirectoryRecord* records = directoryRecords(_image);
+    for (uint32_t i=0; i<header->directoryCount; i++) {
+        const DirectoryRecord& record = records[i];
+        if (static_cast<uint64_t>(record.pathOffset) + record.pathLength >
+                header->stringsSize ||
+            static_cast<uint64_t>(record.firstName) + record.fileCount +
+                record.subdirectoryCount > header->nameCount) {
+            unmap();
+            return false;
+        }
+    }
+    const NameRecord* names = nameRecords(_image);
+    for (uint32_t i=0; i<header->nameCount; i++) {
+        if (static_cast<uint64_t>(names[i].offset) + names[i].length >
+                header->stringsSize) {
+            unmap();
+            return false;
+        }
+    }
+    _serialNumber = header->serialNumber;
+    return true;
+}
+void LibraryIndex::unmap() {
+    if (_image != nullptr) {
+        munmap(const_cast<char*>(_image), _imageSize);
+        _image = nullptr;
+        _imageSize = 0;
+    }
+    _serialNumber = 0;
+}
+void LibraryIndex::write (const vector<Directory>& directories) const {
+    /* Note: If we reach uint max we continue with an even serial number since */
+    /*       uint max is always odd least significant bit is 1.  */
+    uint32_t serialNumber = (_serialNumber == UINT_MAX) ? 2 :
+                            (_serialNumber + 1);
+    vector<DirectoryRecord> records;
+    vector<NameRecord> names;
+    string stringPool;
+    records.reserve(directories.size());
+    auto addString = [&stringPool](const string& s) -> NameRecord {
+        NameRecord name = {static_cast<uint32_t>(stringPool.size()),
+                           static_cast<uint32_t>(s.size()), 0, 0};
+        stringPool += s;
+        return name;
+    };
+    for (const Directory& directory : directories) {
+        DirectoryRecord record;
+        NameRecord pathName = addString(directory.relativePath);
+        record.modificationTime = directory.modificationTime;
+        record.pathOffset = pathName.offset;
+        record.pathLength = pathName.length;
+        record.firstName = names.size();
+        record.fileCount = directory.files.size();
+        record.subdirectoryCount = directory.subdirectories.size();
+        record.reserved = 0;
+        records.push_back(record);
+        for (size_t i=0; i<directory.files.size(); i++) {
+            NameRecord name = addString(directory.files[i]);
+            if (i < directory.durations.size()) {
+                name.frameCount = directory.durations[i].getFrameCount();
+                name.milliseconds = directory.durations[i].getMilliseconds();
+            }
+            names.push_back(name);
+        }
+        for (const string& subdirectory : directory.subdirectories) {
+            names.push_back(addString(subdirectory));
+        }
+    }
+    Header header;
+    memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    header.version = INDEX_VERSION;
+    header.serialNumber = serialNumber;
+    header.directoryCount = records.size();
+    header.nameCount = names.size();
+    header.stringsSize = stringPool.size();
+    header.reserved = 0;
+    Trailer trailer = {serialNumber, 0};
+    // Note: The file that is not mapped is overwritten. Overwriting an existing
+    // file keeps the modification time of the albums directory unchanged.
+    path fileName (_albumsPath);
+    fileName /= ((serialNumber % 2) ? ODD_PREFIX : EVEN_PREFIX) + BASE_FILENAME;
+    ofstream stream (fileName.c_str(), std::ios::binary | std::ios::trunc);
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    stream.write(reinterpret_cast<const char*>(records.data()),
+                 records.size() * sizeof(DirectoryRecord));
+    stream.write(reinterpret_cast<const char*>(names.data()),
+                 names.size() * sizeof(NameRecord));
+    stream.write(stringPool.data(), stringPool.size());
+    stream.write(reinterpret_cast<const char*>(&trailer), sizeof(trailer));
+    stream.close();
+    if (!stream) {
+        cerr << "Unable to write library index " << fileName << endl;
+    }
+}
@@ -0,0 +1,85 @@
+#ifndef LIBRARY_INDEX_HPP
+#define	LIBRARY_INDEX_HPP
+
+#include "LibraryScanner.hpp"
+#include <boost/filesystem/path.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Class that keeps a persistent index of the albums directory tree. The index
+ * is written to the albums directory after the tree has been scanned and is
+ * memory-mapped again on the next start. Every directory is recorded together
+ * with its modification time. Only directories whose modification time differs
+ * from the recorded one are read again, all others are taken from the mapped
+ * index.
+ * The albums tree is read with a LibraryScanner that uses the index as its
+ * directory cache.
+ * Like the RebootSafeString the index uses two files that are written
+ * alternately. If the latest file is damaged because of a power-loss the
+ * previous one is used.
+ */
+class LibraryIndex : public virtual LibraryScanner::IDirectoryCache {
+public:
+    typedef boost::filesystem::path Path;
+    /**
+     * Constructor. Maps the latest valid index file found in the given albums
+     * directory. If there is none an empty index is used.
+     * @param albumsPath The directory containing the albums. The index files
+     *                   are stored in this directory as well.
+     */
+    LibraryIndex (const Path& albumsPath);
+    /**
+     * Destructor. Unmaps the index file.
+     */
+    ~LibraryIndex();
+    LibraryIndex (const LibraryIndex&) = delete;
+    LibraryIndex& operator= (const LibraryIndex&) = delete;
+    /**
+     * Go through the albums path and return all directories found there.
+     * Directories that did not change since the index has been written are
+     * not read again. If any directory changed the index is written again.
+     * @param threadCount The number of threads used for scanning. If zero
+     *                    one thread per processor core is used.
+     * @return All directories of the albums tree.
+     */
+    std::vector<LibraryScanner::Directory> scan (unsigned int threadCount = 0);
+    /**
+     * @see LibraryScanner#IDirectoryCache#findDirectory
+     */
+    bool findDirectory (LibraryScanner::Directory& directory) const override;
+
+protected:
+    typedef LibraryScanner::Directory Directory;
+    /**
+     * Map the index file with the given prefix and check its consistency.
+     * @param prefix The prefix of the index file to be mapped.
+     * @return True if the file has been mapped and is valid.
+     */
+    bool map (const std::string& prefix);
+    /**
+     * Unmap the currently mapped index file.
+     */
+    void unmap();
+    /**
+     * Write the given directories to the index file that does not contain the
+     * latest index.
+     * @param directories The directories of the albums tree.
+     */
+    void write (const std::vector<Directory>& directories) const;
+
+private:
+    Path _albumsPath;
+    const char* _image;
+    std::size_t _imageSize;
+    std::uint32_t _serialNumber;
+    std::unordered_map<std::string, std::uint32_t> _directoryRecords;
+    static const std::string BASE_FILENAME;
+    static const std::string ODD_PREFIX;
+    static const std::string EVEN_PREFIX;
+};
+
+#endif	/* LIBRARY_INDEX_HPP */
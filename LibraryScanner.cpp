@@ -0,0 +1,184 @@
+#include "LibraryScanner.hpp"
+#include "CollationKey.hpp"
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+using std::string;
+using std::vector;
+using std::deque;
+using std::mutex;
+using std::lock_guard;
+using std::unique_lock;
+using std::thread;
+using std::int64_t;
+using boost::filesystem::path;
+
+//==============================================================================
+//----------------------------- LibraryScanner ---------------------------------
+//==============================================================================
+LibraryScanner::LibraryScanner (unsigned int threadCount)
+: _threadCount (threadCount)
+, _cache (nullptr)
+, _pending (0)
+, _queued (0)
+, _directoriesRead (0) {
+    if (_threadCount == 0) {
+        _threadCount = std::max (thread::hardware_concurrency(), 1u);
+    }
+}
+vector<LibraryScanner::Directory> LibraryScanner::scan (const path& root,
+        const IDirectoryCache* cache) {
+    _cache = cache;
+    _directoriesRead = 0;
+    _workers.clear();
+    for (unsigned int i=0; i<_threadCount; i++) {
+        _workers.emplace_back(new Worker());
+    }
+    _pending = 1;
+    _queued = 1;
+    _workers[0]->tasks.push_back(Task {root, string()});
+    // The calling thread is the first worker.
+    vector<thread> threads;
+    for (unsigned int i=1; i<_threadCount; i++) {
+        threads.emplace_back(&LibraryScanner::work, this, i);
+    }
+    work(0);
+    for (thread& t : threads) {
+        t.join();
+    }
+    vector<Directory> directories (std::move(_workers[0]->directories));
+    for (unsigned int i=1; i<_threadCount; i++) {
+        vector<Directory>& workerDirectories = _workers[i]->directories;
+        directories.insert(directories.end(),
+                           std::make_move_iterator(workerDirectories.begin()),
+                           std::make_move_iterator(workerDirectories.end()));
+    }
+    _workers.clear();
+    _cache = nullptr;
+    return directories;
+}
+unsigned int LibraryScanner::getDirectoriesRead() const {
+    return _directoriesRead;
+}
+void LibraryScanner::work (unsigned int workerIndex) {
+    for (;;) {
+        Task task;
+        if (takeTask(workerIndex, task)) {
+            scanDirectory(workerIndex, task);
+            if (--_pending == 0) {
+                { lock_guard<mutex> lock (_idleMutex); }
+                _idleCondition.notify_all();
+            }
+            continue;
+        }
+        unique_lock<mutex> lock (_idleMutex);
+        _idleCondition.wait(lock, [this]{return _queued > 0 || _pending == 0;});
+        if (_pending == 0) {
+            return;
+        }
+    }
+}
+bool LibraryScanner::takeTask (unsigned int workerIndex, Task& task) {
+    {
+        Worker& own = *_workers[workerIndex];
+        lock_guard<mutex> lock (own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            --_queued;
+            return true;
+        }
+    }
+    for (unsigned int i=1; i<_threadCount; i++) {
+        Worker& victim = *_workers[(workerIndex + i) % _threadCount];
+        lock_guard<mutex> lock (victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            --_queued;
+            return true;
+        }
+    }
+    return false;
+}
+void LibraryScanner::addTask (unsigned int workerIndex, Task&& task) {
+    ++_pending;
+    {
+        Worker& own = *_workers[workerIndex];
+        lock_guard<mutex> lock (own.mutex);
+        own.tasks.push_back(std::move(task));
+    }
+    ++_queued;
+    { lock_guard<mutex> lock (_idleMutex); }
+    _idleCondition.notify_one();
+}
+void LibraryScanner::scanDirectory (unsigned int workerIndex,
+                                    const Task& task) {
+    struct stat status;
+    if (stat(task.path.c_str(), &status) != 0 || !S_ISDIR(status.st_mode)) {
+        return;
+    }
+    Directory directory;
+    directory.path = task.path;
+    directory.relativePath = task.relativePath;
+    directory.modificationTime =
+            static_cast<int64_t>(status.st_mtim.tv_sec) * 1000000000 +
+            status.st_mtim.tv_nsec;
+    if (_cache == nullptr || !_cache->findDirectory(directory)) {
+        readDirectory(directory);
+        ++_directoriesRead;
+    }
+    for (const string& subdirectory : directory.subdirectories) {
+        addTask(workerIndex, Task {task.path / subdirectory,
+                task.relativePath.empty() ? subdirectory :
+                task.relativePath + '/' + subdirectory});
+    }
+    _workers[workerIndex]->directories.push_back(std::move(directory));
+}
+void LibraryScanner::readDirectory (Directory& directory,
+                                    bool readDurations) {
+    DIR* dir = opendir(directory.path.c_str());
+    if (dir == nullptr) {
+        return;
+    }
+    while (const struct dirent* entry = readdir(dir)) {
+        const char* name = entry->d_name;
+        if (name[0] == '.' && (name[1] == '\0' ||
+                              (name[1] == '.' && name[2] == '\0'))) {
+            continue;
+        }
+        unsigned char type = entry->d_type;
+        if (type == DT_UNKNOWN || type == DT_LNK) {
+            // Note: The file system does not tell the type or the entry is a
+            // symbolic link that has to be followed. Only then stat is needed.
+            struct stat status;
+            if (fstatat(dirfd(dir), name, &status, 0) != 0) {
+                continue;
+            }
+            type = S_ISDIR(status.st_mode) ? DT_DIR : DT_REG;
+        }
+        if (type == DT_DIR) {
+            directory.subdirectories.push_back(name);
+        } else {
+            size_t length = strlen(name);
+            if (length > 4 && strcmp(name + length - 4, ".mp3") == 0) {
+                directory.files.push_back(name);
+            }
+        }
+    }
+    CollationKey::sort (directory.files);
+    CollationKey::sort (directory.subdirectories);
+    if (readDurations) {
+        directory.durations.reserve(directory.files.size());
+        for (const string& file : directory.files) {
+            directory.durations.push_back(Mp3Duration::read(dirfd(dir),
+                                                            file.c_str()));
+        }
+    }
+    closedir(dir);
+}
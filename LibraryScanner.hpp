@@ -0,0 +1,137 @@
+#ifndef LIBRARY_SCANNER_HPP
+#define	LIBRARY_SCANNER_HPP
+
+#include "Mp3Duration.hpp"
+#include <boost/filesystem/path.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * Class that scans the albums directory tree with several threads. Each
+ * directory is a task of its own. Every thread keeps its own queue of
+ * directories and steals from the other queues when its own queue is empty.
+ * The type of a directory entry is taken from the directory entry itself.
+ * Only if the file system does not provide it (or for symbolic links) the
+ * entry is examined with stat. The durations of the mp3 files are determined
+ * when a directory is read (see Mp3Duration).
+ */
+class LibraryScanner {
+public:
+    typedef boost::filesystem::path Path;
+    /**
+     * A directory of the albums tree as read from the file system or from a
+     * cache. The files and sub-directories are sorted by name in
+     * natural order (see CollationKey). The durations belong to the files
+     * with the same index. They are empty if they have not been read.
+     */
+    struct Directory {
+        Path path;
+        std::string relativePath;
+        std::int64_t modificationTime;
+        std::vector<std::string> files;
+        std::vector<Mp3Duration> durations;
+        std::vector<std::string> subdirectories;
+    };
+    /**
+     * Interface for a cache that knows the content of directories that did
+     * not change. Note that its methods are called concurrently by the
+     * scanning threads.
+     */
+    class IDirectoryCache {
+    public:
+        virtual ~IDirectoryCache() {}
+        /**
+         * Fill in the files and sub-directories of the given directory if the
+         * cache knows the directory with the same modification time.
+         * @param directory The directory with the relative path and the
+         *                  modification time set.
+         * @return True if the content has been filled in, else false.
+         */
+        virtual bool findDirectory (Directory& directory) const = 0;
+    };
+    /**
+     * Constructor.
+     * @param threadCount The number of threads used for scanning. If zero the
+     *                    number of hardware threads is used.
+     */
+    LibraryScanner (unsigned int threadCount = 0);
+    /**
+     * Scan the given directory and all its sub-directories.
+     * @param root The directory to be scanned.
+     * @param cache Optional cache that is asked before a directory is read
+     *              from the file system.
+     * @return All directories found below and including the root directory.
+     *         The order of the directories is undefined.
+     */
+    std::vector<Directory> scan (const Path& root,
+                                 const IDirectoryCache* cache = nullptr);
+    /**
+     * Get the number of directories that have been read from the file system
+     * during the last scan (i.e. that were not found in the cache).
+     * @return Number of directories read.
+     */
+    unsigned int getDirectoriesRead() const;
+    /**
+     * Read the files and sub-directories of the given directory from the file
+     * system. Sub-directories are not read.
+     * @param directory The directory with the path set.
+     * @param readDurations If true the beginning of each file is read to
+     *                      determine its duration. If false the durations
+     *                      are left empty.
+     */
+    static void readDirectory (Directory& directory,
+                               bool readDurations = true);
+
+protected:
+    /**
+     * A directory that still has to be scanned.
+     */
+    struct Task {
+        Path path;
+        std::string relativePath;
+    };
+    /**
+     * The queue of tasks and the results of one scanning thread.
+     */
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        std::vector<Directory> directories;
+    };
+    /**
+     * Run the scanning loop of the given worker until all directories have
+     * been scanned.
+     */
+    void work (unsigned int workerIndex);
+    /**
+     * Take the next task either from the worker's own queue (newest first) or
+     * steal one from another worker's queue (oldest first).
+     */
+    bool takeTask (unsigned int workerIndex, Task& task);
+    /**
+     * Add a task to the queue of the given worker and wake up idle workers.
+     */
+    void addTask (unsigned int workerIndex, Task&& task);
+    /**
+     * Scan a single directory and add tasks for its sub-directories.
+     */
+    void scanDirectory (unsigned int workerIndex, const Task& task);
+
+private:
+    unsigned int _threadCount;
+    std::vector<std::unique_ptr<Worker>> _workers;
+    const IDirectoryCache* _cache;
+    std::atomic<unsigned int> _pending;
+    std::atomic<int> _queued;
+    std::atomic<unsigned int> _directoriesRead;
+    std::mutex _idleMutex;
+    std::condition_variable _idleCondition;
+};
+
+#endif	/* LIBRARY_SCANNER_HPP */
@@ -0,0 +1,277 @@
+#include "LibraryWatcher.hpp"
+#include "LibraryIndex.hpp"
+#include <boost/asio/io_service.hpp>
+#include <boost/bind.hpp>
+#include <sys/inotify.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <iostream>
+
+using std::vector;
+using std::shared_ptr;
+using std::make_shared;
+using std::cerr;
+using std::endl;
+using boost::bind;
+using boost::asio::io_service;
+using boost::filesystem::path;
+using boost::posix_time::time_duration;
+using boost::posix_time::seconds;
+
+namespace {
+    // Note: Taken from linux/ioprio.h which is not available everywhere.
+    const int IOPRIO_CLASS_SHIFT = 13;
+    const int IOPRIO_CLASS_IDLE = 3;
+    const int IOPRIO_WHO_PROCESS = 1;
+}
+
+//==============================================================================
+//----------------------------- LibraryWatcher ---------------------------------
+//==============================================================================
+const time_duration LibraryWatcher::QUIET_PERIOD (seconds(1));
+const int LibraryWatcher::LOW_PRIORITY_NICE (19);
+
+LibraryWatcher::LibraryWatcher (const shared_ptr<const Library>& library,
+        const vector<LibraryScanner::Directory>& directories,
+        io_service& ioService)
+: _ioService (ioService)
+, _handle (make_shared<LibraryWatcher*>(this))
+, _library (library)
+, _inotifyFileDescriptor (-1)
+, _rescanRequired (false)
+, _lowPriority (false) {
+    if (!initialize()) {
+        return;
+    }
+    vector<path> paths;
+    paths.reserve(directories.size());
+    for (const LibraryScanner::Directory& directory : directories) {
+        if (directory.relativePath.empty()) {
+            _root = directory.path;
+        }
+        paths.push_back(directory.path);
+    }
+    _thread = std::thread(&LibraryWatcher::watch, this, std::move(paths));
+}
+LibraryWatcher::LibraryWatcher (const path& albumsPath, io_service& ioService,
+                                bool lowPriority)
+: _ioService (ioService)
+, _handle (make_shared<LibraryWatcher*>(this))
+, _inotifyFileDescriptor (-1)
+, _rescanRequired (false)
+, _lowPriority (lowPriority)
+, _root (albumsPath) {
+    // Note: Even if watching is not possible the library is scanned.
+    initialize();
+    _thread = std::thread(&LibraryWatcher::scanAndWatch, this);
+}
+LibraryWatcher::~LibraryWatcher() {
+    if (_thread.joinable()) {
+        char stop = 's';
+        if (_stopPipe[1] >= 0 && write(_stopPipe[1], &stop, 1) < 0) {
+            cerr << "Unable to stop library watcher." << endl;
+        }
+        _thread.join();
+    }
+    *_handle = nullptr;
+    for (int fd : {_stopPipe[0], _stopPipe[1], _inotifyFileDescriptor}) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+}
+void LibraryWatcher::addListener (IListener* listener) {
+    _listeners.push_back(listener);
+}
+bool LibraryWatcher::initialize() {
+    _stopPipe[0] = -1;
+    _stopPipe[1] = -1;
+    _inotifyFileDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (_inotifyFileDescriptor < 0) {
+        cerr << "Unable to watch the albums directory: " << strerror(errno)
+             << endl;
+        return false;
+    }
+    if (pipe2(_stopPipe, O_CLOEXEC) < 0) {
+        cerr << "Unable to create pipe for library watcher: "
+             << strerror(errno) << endl;
+        _stopPipe[0] = -1;
+        _stopPipe[1] = -1;
+        return false;
+    }
+    return true;
+}
+void LibraryWatcher::scanAndWatch() {
+    if (_lowPriority) {
+        // Note: The idle I/O class is only honoured by I/O schedulers that
+        // support priorities (e.g. BFQ). The threads of the scanner inherit
+        // both priorities.
+        syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0,
+                (IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT));
+        setpriority(PRIO_PROCESS, syscall(SYS_gettid), LOW_PRIORITY_NICE);
+    }
+    vector<LibraryScanner::Directory> directories =
+            LibraryIndex(_root).scan(_lowPriority ? 1 : 0);
+    _library = make_shared<const Library>(directories);
+    _ioService.post(bind(&LibraryWatcher::publish, _handle, _library));
+    if (_inotifyFileDescriptor < 0 || _stopPipe[0] < 0) {
+        return;
+    }
+    vector<path> paths;
+    paths.reserve(directories.size());
+    for (const LibraryScanner::Directory& directory : directories) {
+        paths.push_back(directory.path);
+    }
+    directories.clear();
+    watch(std::move(paths));
+}
+void LibraryWatcher::watch (vector<path> directories) {
+    for (const path& directory : directories) {
+        if (!addWatch(directory)) {
+            break;
+        }
+    }
+    struct pollfd fds[2];
+    fds[0].fd = _inotifyFileDescriptor;
+    fds[0].events = POLLIN;
+    fds[1].fd = _stopPipe[0];
+    fds[1].events = POLLIN;
+    for (;;) {
+        bool changesPending = _rescanRequired || !_changedDirectories.empty() ||
+                !_addedDirectories.empty() || !_removedDirectories.empty();
+        int result = poll(fds, 2, changesPending ?
+                QUIET_PERIOD.total_milliseconds() : -1);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            cerr << "Library watcher stopped: " << strerror(errno) << endl;
+            return;
+        } else if (fds[1].revents != 0) {
+            return;
+        } else if (result == 0) {
+            applyChanges();
+        } else if (fds[0].revents & POLLIN) {
+            readEvents();
+        }
+    }
+}
+bool LibraryWatcher::addWatch (const path& directory) {
+    int wd = inotify_add_watch(_inotifyFileDescriptor, directory.c_str(),
+            IN_CREATE | IN_CLOSE_WRITE | IN_DELETE | IN_MOVED_FROM |
+            IN_MOVED_TO | IN_ONLYDIR);
+    if (wd < 0) {
+        cerr << "Unable to watch directory " << directory << ": "
+             << strerror(errno) << endl;
+        return false;
+    }
+    _watchedDirectories[wd] = directory;
+    return true;
+}
+void LibraryWatcher::removeWatches (const path& directory) {
+    for (auto it = _watchedDirectories.begin();
+         it != _watchedDirectories.end();) {
+        if (Library::isInside(it->second, directory)) {
+            inotify_rm_watch(_inotifyFileDescriptor, it->first);
+            it = _watchedDirectories.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+void LibraryWatcher::readEvents() {
+    char buffer[4096]
+        __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    for (;;) {
+        ssize_t length = read(_inotifyFileDescriptor, buffer, sizeof(buffer));
+        if (length <= 0) {
+            return;
+        }
+        const struct inotify_event* event;
+        for (char* p = buffer; p < buffer + length;
+             p += sizeof(struct inotify_event) + event->len) {
+            event = reinterpret_cast<const struct inotify_event*>(p);
+            if (event->mask & IN_Q_OVERFLOW) {
+                _rescanRequired = true;
+                continue;
+            }
+            auto itWatched = _watchedDirectories.find(event->wd);
+            if (itWatched == _watchedDirectories.end()) {
+                continue;
+            } else if (event->mask & IN_IGNORED) {
+                _watchedDirectories.erase(itWatched);
+                continue;
+            } else if (event->len == 0) {
+                continue;
+            }
+            const path& directory = itWatched->second;
+            if (event->mask & IN_ISDIR) {
+                if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    _addedDirectories.insert(directory / event->name);
+                } else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                    _removedDirectories.insert(directory / event->name);
+                }
+            } else {
+                size_t nameLength = strlen(event->name);
+                if (nameLength > 4 &&
+                    strcmp(event->name + nameLength - 4, ".mp3") == 0) {
+                    _changedDirectories.insert(directory);
+                }
+            }
+        }
+    }
+}
+void LibraryWatcher::applyChanges() {
+    Library::AlbumMap changedAlbums;
+    vector<path> removedDirectories;
+    if (_rescanRequired && !_root.empty()) {
+        // Note: Events have been lost. Therefore the whole tree is read again.
+        _removedDirectories.insert(_root);
+        _addedDirectories.insert(_root);
+    }
+    // Note: Removed directories are handled first since a directory may have
+    // been removed and created again.
+    for (const path& directory : _removedDirectories) {
+        removeWatches(directory);
+        removedDirectories.push_back(directory);
+    }
+    LibraryScanner scanner;
+    for (const path& directory : _addedDirectories) {
+        // Note: The directory is watched before it is read so that no title
+        // copied meanwhile gets lost.
+        addWatch(directory);
+        for (const LibraryScanner::Directory& scanned :
+                scanner.scan(directory)) {
+            if (scanned.path != directory) {
+                addWatch(scanned.path);
+            }
+            changedAlbums[scanned.path] = scanned;
+        }
+    }
+    for (const path& directory : _changedDirectories) {
+        LibraryScanner::Directory changed;
+        changed.path = directory;
+        LibraryScanner::readDirectory(changed);
+        changedAlbums[directory] = std::move(changed);
+    }
+    _rescanRequired = false;
+    _removedDirectories.clear();
+    _addedDirectories.clear();
+    _changedDirectories.clear();
+    _library = _library->update(changedAlbums, removedDirectories);
+    _ioService.post(bind(&LibraryWatcher::publish, _handle, _library));
+}
+void LibraryWatcher::publish (const shared_ptr<LibraryWatcher*>& watcher,
+                              const shared_ptr<const Library>& library) {
+    if (*watcher == nullptr) {
+        return;
+    }
+    for (auto l : (*watcher)->_listeners) {
+        l->libraryChanged(library);
+    }
+}
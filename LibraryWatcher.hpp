@@ -0,0 +1,151 @@
+#ifndef LIBRARY_WATCHER_HPP
+#define	LIBRARY_WATCHER_HPP
+
+#include "Library.hpp"
+#include "LibraryScanner.hpp"
+#include <boost/filesystem/path.hpp>
+#include <boost/date_time/posix_time/posix_time_duration.hpp>
+#include <map>
+#include <memory>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace boost {
+    namespace asio {
+        class io_service;
+    }
+}
+
+/**
+ * Class that watches the albums directory tree with inotify. Changes are
+ * collected until the tree has been quiet for a moment. Then only the changed
+ * directories are read again and a new Library snapshot is built. Watching
+ * and building is done in a thread of its own; the new snapshot is handed
+ * over to the listeners in the context of the io_service.
+ * Note that the persistent LibraryIndex is not updated. It detects the
+ * changed directories by their modification time on the next start.
+ */
+class LibraryWatcher {
+public:
+    typedef boost::filesystem::path Path;
+    /**
+     * Interface that has to be implemented by listeners on library changes.
+     * The listeners are called in the context of the boost asio io_service.
+     */
+    class IListener {
+    public:
+        /**
+         * Virtual destructor.
+         */
+        virtual ~IListener() {}
+        /**
+         * Called when a new library snapshot has been built.
+         * @param library The new library snapshot.
+         */
+        virtual void libraryChanged (
+                const std::shared_ptr<const Library>& library) = 0;
+    };
+    /**
+     * Constructor. Starts watching the given directories.
+     * @param library The library snapshot that represents the current state
+     *                of the watched directories.
+     * @param directories All directories of the albums tree.
+     * @param ioService The io_service used as the context for calling the
+     *                  listeners.
+     */
+    LibraryWatcher (const std::shared_ptr<const Library>& library,
+            const std::vector<LibraryScanner::Directory>& directories,
+            boost::asio::io_service& ioService);
+    /**
+     * Constructor. Scans the given albums directory with a LibraryIndex in
+     * the watching thread, hands over the complete library to the listeners
+     * and then starts watching. This allows to start the playback before the
+     * albums directory has been scanned.
+     * @param albumsPath The directory containing the albums.
+     * @param ioService The io_service used as the context for calling the
+     *                  listeners.
+     * @param lowPriority If true the watching thread runs with idle I/O
+     *                    priority and low CPU priority and scans with a
+     *                    single thread, so that the playback is not
+     *                    disturbed.
+     */
+    LibraryWatcher (const Path& albumsPath,
+                    boost::asio::io_service& ioService,
+                    bool lowPriority = false);
+    /**
+     * Destructor. Stops the watching thread. Snapshots that have not been
+     * handed over yet are dropped. Has to be called in the context of the
+     * io_service.
+     */
+    ~LibraryWatcher();
+    LibraryWatcher (const LibraryWatcher&) = delete;
+    LibraryWatcher& operator= (const LibraryWatcher&) = delete;
+    /**
+     * Add a listener that is called when the library has changed. Has to be
+     * called in the context of the io_service before it handles the first
+     * change.
+     * @param listener The listener to be added.
+     */
+    void addListener (IListener* listener);
+
+protected:
+    /**
+     * Create the inotify instance and the pipe to stop the watching thread.
+     * @return True if watching is possible.
+     */
+    bool initialize();
+    /**
+     * The watching thread if the albums directory has to be scanned first.
+     */
+    void scanAndWatch();
+    /**
+     * The loop of the watching thread.
+     */
+    void watch (std::vector<Path> directories);
+    /**
+     * Start watching the given directory.
+     * @return True if the directory is watched.
+     */
+    bool addWatch (const Path& directory);
+    /**
+     * Stop watching the given directory and all directories below.
+     */
+    void removeWatches (const Path& directory);
+    /**
+     * Read the pending inotify events and remember what has changed.
+     */
+    void readEvents();
+    /**
+     * Read the changed directories again and publish a new snapshot.
+     */
+    void applyChanges();
+    /**
+     * Call the listeners with the given snapshot. Called in the context of
+     * the io_service.
+     * @param watcher The watcher or null if it has been destroyed meanwhile.
+     * @param library The new snapshot.
+     */
+    static void publish (const std::shared_ptr<LibraryWatcher*>& watcher,
+                         const std::shared_ptr<const Library>& library);
+
+private:
+    boost::asio::io_service& _ioService;
+    std::shared_ptr<LibraryWatcher*> _handle;
+    std::shared_ptr<const Library> _library;
+    std::vector<IListener*> _listeners;
+    int _inotifyFileDescriptor;
+    int _stopPipe[2];
+    std::map<int, Path> _watchedDirectories;
+    std::set<Path> _changedDirectories;
+    std::set<Path> _addedDirectories;
+    std::set<Path> _removedDirectories;
+    bool _rescanRequired;
+    bool _lowPriority;
+    Path _root;
+    std::thread _thread;
+    static const boost::posix_time::time_duration QUIET_PERIOD;
+    static const int LOW_PRIORITY_NICE;
+};
+
+#endif	/* LIBRARY_WATCHER_HPP */
@@ -0,0 +1,108 @@
+#include "LogRing.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+using std::string;
+using std::size_t;
+using std::min;
+using std::cerr;
+using std::endl;
+using std::chrono::steady_clock;
+using boost::asio::mutable_buffer;
+
+//==============================================================================
+//-------------------------------- LogRing -------------------------------------
+//==============================================================================
+const size_t LogRing::SIZE;
+const unsigned int LogRing::MAX_LINES_PER_INTERVAL (10);
+const std::chrono::seconds LogRing::INTERVAL (10);
+
+LogRing::LogRing (const string& prefix)
+: _prefix (prefix)
+, _begin (0)
+, _size (0)
+, _droppedByteCount (0)
+, _unreportedByteCount (0)
+, _intervalStart (steady_clock::now())
+, _lineCount (0) {
+}
+LogRing::MutableBuffers LogRing::prepare() {
+    if (_size == SIZE) {
+        // Note: The part of a line that does not fit into the ring is
+        // dropped, so the program never has to wait until its output is read.
+        drop(_size);
+    }
+    if (_size == 0) {
+        _begin = 0;
+    }
+    size_t end = (_begin + _size) % SIZE;
+    if (end < _begin) {
+        MutableBuffers buffers = {{
+            mutable_buffer(_ring.data() + end, _begin - end),
+            mutable_buffer()
+        }};
+        return buffers;
+    }
+    MutableBuffers buffers = {{
+        mutable_buffer(_ring.data() + end, SIZE - end),
+        mutable_buffer(_ring.data(), _begin)
+    }};
+    return buffers;
+}
+void LogRing::commit (size_t length) {
+    // Note: The partial line kept from the last read does not contain a line
+    // terminator, so only the new data has to be searched.
+    size_t searched = _size;
+    _size += length;
+    while (searched < _size) {
+        size_t position = (_begin + searched) % SIZE;
+        size_t count = min(_size - searched, SIZE - position);
+        const char* begin = _ring.data() + position;
+        const char* lineEnd = static_cast<const char*>(memchr(begin, '\n',
+                                                              count));
+        if (lineEnd == nullptr) {
+            searched += count;
+        } else {
+            logLine(searched + (lineEnd - begin) + 1);
+            searched = 0;
+        }
+    }
+}
+void LogRing::clear() {
+    _begin = 0;
+    _size = 0;
+}
+unsigned long LogRing::getDroppedByteCount() const {
+    return _droppedByteCount;
+}
+void LogRing::logLine (size_t length) {
+    steady_clock::time_point now = steady_clock::now();
+    if (now - _intervalStart >= INTERVAL) {
+        if (_unreportedByteCount > 0) {
+            cerr << _prefix << _unreportedByteCount
+                 << " bytes of output dropped" << endl;
+            _unreportedByteCount = 0;
+        }
+        _intervalStart = now;
+        _lineCount = 0;
+    }
+    if (_lineCount >= MAX_LINES_PER_INTERVAL) {
+        drop(length);
+        return;
+    }
+    _lineCount++;
+    // Note: The line may wrap around the end of the ring.
+    size_t firstPart = min(length, SIZE - _begin);
+    cerr << _prefix;
+    cerr.write(_ring.data() + _begin, firstPart);
+    cerr.write(_ring.data(), length - firstPart);
+    _begin = (_begin + length) % SIZE;
+    _size -= length;
+}
+void LogRing::drop (size_t length) {
+    _droppedByteCount += length;
+    _unreportedByteCount += length;
+    _begin = (_begin + length) % SIZE;
+    _size -= length;
+}
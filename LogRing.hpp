@@ -0,0 +1,83 @@
+#ifndef LOG_RING_HPP
+#define	LOG_RING_HPP
+
+#include <boost/asio/buffer.hpp>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+/**
+ * Fixed size ring buffer for the output of a program that is logged line by
+ * line, e.g. the error output of mpg123. The output is read directly into the
+ * ring (see prepare and commit), so it is drained without allocating memory
+ * however much is written. At most a few lines are logged per interval, the
+ * other lines are dropped. A line that does not fit into the ring is dropped
+ * as well. The number of dropped bytes is counted and logged from time to
+ * time.
+ */
+class LogRing {
+public:
+    typedef std::array<boost::asio::mutable_buffer, 2> MutableBuffers;
+    /**
+     * Constructor.
+     * @param prefix The text each logged line is prefixed with.
+     */
+    LogRing (const std::string& prefix);
+    LogRing (const LogRing&) = delete;
+    LogRing& operator= (const LogRing&) = delete;
+    /**
+     * Get the free part of the ring the next output has to be read into. It
+     * consists of two buffers if it wraps around the end of the ring. If the
+     * ring is full, the partial line in it is dropped.
+     * @return The free part of the ring.
+     */
+    MutableBuffers prepare();
+    /**
+     * Log the complete lines of the data that has been read into the free
+     * part of the ring, as far as the rate limit allows.
+     * @param length The number of bytes that have been read.
+     */
+    void commit (std::size_t length);
+    /**
+     * Drop the partial line kept from the last read, e.g. because the output
+     * is read from a new program.
+     */
+    void clear();
+    /**
+     * Get the number of bytes that have been dropped so far.
+     * @return The number of bytes dropped.
+     */
+    unsigned long getDroppedByteCount() const;
+
+protected:
+    /**
+     * Log the line at the begin of the ring or drop it, if too many lines
+     * have been logged in the current interval. The line is removed from
+     * the ring.
+     * @param length The length of the line including the line terminator.
+     */
+    void logLine (std::size_t length);
+    /**
+     * Remove the given number of bytes from the begin of the ring and count
+     * them as dropped.
+     * @param length The number of bytes to be dropped.
+     */
+    void drop (std::size_t length);
+
+private:
+    static const std::size_t SIZE = 4096;
+    static const unsigned int MAX_LINES_PER_INTERVAL;
+    static const std::chrono::seconds INTERVAL;
+    const std::string _prefix;
+    std::array<char, SIZE> _ring;
+    std::size_t _begin;
+    std::size_t _size;
+    unsigned long _droppedByteCount;
+    unsigned long _unreportedByteCount;
+    std::chrono::steady_clock::time_point _intervalStart;
+    unsigned int _lineCount;
+};
+
+#endif	/* LOG_RING_HPP */
+
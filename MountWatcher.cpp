@@ -0,0 +1,164 @@
+#include "MountWatcher.hpp"
+#include "Library.hpp"
+#include <boost/asio/io_service.hpp>
+#include <boost/bind.hpp>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+using std::string;
+using std::set;
+using std::shared_ptr;
+using std::make_shared;
+using std::istringstream;
+using std::cout;
+using std::cerr;
+using std::endl;
+using boost::bind;
+using boost::asio::io_service;
+using boost::filesystem::path;
+
+//==============================================================================
+//------------------------------ MountWatcher ----------------------------------
+//==============================================================================
+const char* const MountWatcher::MOUNTS_FILENAME ("/proc/self/mounts");
+
+MountWatcher::MountWatcher (const path& volumesPath, io_service& ioService)
+: _ioService (ioService)
+, _handle (make_shared<MountWatcher*>(this))
+, _volumesPath (volumesPath)
+, _mountsFileDescriptor (open(MOUNTS_FILENAME, O_RDONLY | O_CLOEXEC)) {
+    _stopPipe[0] = -1;
+    _stopPipe[1] = -1;
+    _volumesPath.remove_trailing_separator();
+    if (_mountsFileDescriptor < 0) {
+        cerr << "Unable to watch the mounted volumes: " << strerror(errno)
+             << endl;
+        return;
+    }
+    _mountPoints = readMountPoints();
+    if (pipe2(_stopPipe, O_CLOEXEC) < 0) {
+        cerr << "Unable to create pipe for mount watcher: "
+             << strerror(errno) << endl;
+        return;
+    }
+    _thread = std::thread(&MountWatcher::watch, this);
+}
+MountWatcher::~MountWatcher() {
+    if (_thread.joinable()) {
+        char stop = 's';
+        if (write(_stopPipe[1], &stop, 1) < 0) {
+            cerr << "Unable to stop mount watcher." << endl;
+        }
+        _thread.join();
+    }
+    *_handle = nullptr;
+    for (int fd : {_stopPipe[0], _stopPipe[1], _mountsFileDescriptor}) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+}
+void MountWatcher::addListener (IListener* listener) {
+    _listeners.push_back(listener);
+}
+const set<path>& MountWatcher::getMountPoints() const {
+    return _mountPoints;
+}
+void MountWatcher::watch() {
+    struct pollfd fds[2];
+    fds[0].fd = _mountsFileDescriptor;
+    fds[0].events = POLLPRI;
+    fds[1].fd = _stopPipe[0];
+    fds[1].events = POLLIN;
+    for (;;) {
+        int result = poll(fds, 2, -1);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            cerr << "Mount watcher stopped: " << strerror(errno) << endl;
+            return;
+        } else if (fds[1].revents != 0) {
+            return;
+        } else if (fds[0].revents & (POLLPRI | POLLERR)) {
+            // Note: Reading the mount table again acknowledges the change.
+            _ioService.post(bind(&MountWatcher::publish, _handle,
+                                 readMountPoints()));
+        }
+    }
+}
+set<path> MountWatcher::readMountPoints() const {
+    string mounts;
+    char buffer[4096];
+    off_t offset = 0;
+    for (;;) {
+        ssize_t length = pread(_mountsFileDescriptor, buffer, sizeof(buffer),
+                               offset);
+        if (length <= 0) {
+            break;
+        }
+        mounts.append(buffer, length);
+        offset += length;
+    }
+    set<path> mountPoints;
+    istringstream iss (mounts);
+    string line;
+    while (getline(iss, line)) {
+        istringstream issLine (line);
+        string device;
+        string escapedMountPoint;
+        issLine >> device >> escapedMountPoint;
+        // Note: Blanks and other special characters of the mount point are
+        // escaped as three octal digits, e.g. \040 for a blank.
+        string mountPoint;
+        for (size_t i=0; i<escapedMountPoint.size(); i++) {
+            if (escapedMountPoint[i] == '\\' &&
+                i + 3 < escapedMountPoint.size()) {
+                mountPoint.push_back(static_cast<char>(
+                        strtol(escapedMountPoint.substr(i + 1, 3).c_str(),
+                               nullptr, 8)));
+                i += 3;
+            } else {
+                mountPoint.push_back(escapedMountPoint[i]);
+            }
+        }
+        path mountPointPath (mountPoint);
+        if (mountPointPath != _volumesPath &&
+            Library::isInside(mountPointPath, _volumesPath)) {
+            mountPoints.insert(mountPointPath);
+        }
+    }
+    return mountPoints;
+}
+void MountWatcher::publish (const shared_ptr<MountWatcher*>& watcher,
+                            const set<path>& mountPoints) {
+    if (*watcher == nullptr) {
+        return;
+    }
+    MountWatcher& self = **watcher;
+    set<path> previousMountPoints;
+    previousMountPoints.swap(self._mountPoints);
+    self._mountPoints = mountPoints;
+    for (const path& mountPoint : previousMountPoints) {
+        if (mountPoints.count(mountPoint) == 0) {
+            cout << "Volume unmounted from " << mountPoint << endl;
+            for (auto l : self._listeners) {
+                l->volumeUnmounted(mountPoint);
+            }
+        }
+    }
+    for (const path& mountPoint : mountPoints) {
+        if (previousMountPoints.count(mountPoint) == 0) {
+            cout << "Volume mounted to " << mountPoint << endl;
+            for (auto l : self._listeners) {
+                l->volumeMounted(mountPoint);
+            }
+        }
+    }
+}
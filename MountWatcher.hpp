@@ -0,0 +1,104 @@
+#ifndef MOUNT_WATCHER_HPP
+#define	MOUNT_WATCHER_HPP
+
+#include <boost/filesystem/path.hpp>
+#include <memory>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace boost {
+    namespace asio {
+        class io_service;
+    }
+}
+
+/**
+ * Class that reports volumes (e.g. USB sticks) mounted to or unmounted from
+ * a directory. The mount table /proc/self/mounts is watched in a thread of
+ * its own; the kernel signals every change of the mount table with POLLPRI.
+ * All mount points below the volumes directory are reported.
+ */
+class MountWatcher {
+public:
+    typedef boost::filesystem::path Path;
+    /**
+     * Interface that has to be implemented by listeners on mount events.
+     * The listeners are called in the context of the boost asio io_service.
+     */
+    class IListener {
+    public:
+        /**
+         * Virtual destructor.
+         */
+        virtual ~IListener() {}
+        /**
+         * Called when a volume has been mounted.
+         * @param mountPoint The directory the volume has been mounted to.
+         */
+        virtual void volumeMounted (const Path& mountPoint) = 0;
+        /**
+         * Called when a volume has been unmounted.
+         * @param mountPoint The directory the volume had been mounted to.
+         */
+        virtual void volumeUnmounted (const Path& mountPoint) = 0;
+    };
+    /**
+     * Constructor. Reads the mount points that exist already and starts
+     * watching the mount table.
+     * @param volumesPath The directory below which volumes are mounted.
+     * @param ioService The io_service used as the context for calling the
+     *                  listeners.
+     */
+    MountWatcher (const Path& volumesPath, boost::asio::io_service& ioService);
+    /**
+     * Destructor. Stops the watching thread.
+     */
+    ~MountWatcher();
+    MountWatcher (const MountWatcher&) = delete;
+    MountWatcher& operator= (const MountWatcher&) = delete;
+    /**
+     * Add a listener that is called when a volume has been mounted or
+     * unmounted. Has to be called in the context of the io_service.
+     * @param listener The listener to be added.
+     */
+    void addListener (IListener* listener);
+    /**
+     * Get the volumes that are mounted currently. Has to be called in the
+     * context of the io_service.
+     * @return The mount points of the volumes.
+     */
+    const std::set<Path>& getMountPoints() const;
+
+protected:
+    /**
+     * The loop of the watching thread.
+     */
+    void watch();
+    /**
+     * Read the mount table.
+     * @return The mount points below the volumes directory.
+     */
+    std::set<Path> readMountPoints() const;
+    /**
+     * Compare the given mount points with the known ones and call the
+     * listeners. Called in the context of the io_service.
+     * @param watcher The watcher or null if it has been destroyed meanwhile.
+     * @param mountPoints The mount points currently found in the mount table.
+     */
+    static void publish (const std::shared_ptr<MountWatcher*>& watcher,
+                         const std::set<Path>& mountPoints);
+
+private:
+    boost::asio::io_service& _ioService;
+    std::shared_ptr<MountWatcher*> _handle;
+    Path _volumesPath;
+    std::vector<IListener*> _listeners;
+    std::set<Path> _mountPoints;
+    int _mountsFileDescriptor;
+    int _stopPipe[2];
+    std::thread _thread;
+    static const char* const MOUNTS_FILENAME;
+};
+
+#endif	/* MOUNT_WATCHER_HPP */
@@ -0,0 +1,179 @@
+#include "Mp3Duration.hpp"
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+
+using std::uint8_t;
+using std::uint32_t;
+using std::uint64_t;
+
+namespace {
+    /** Size of the header of an ID3v2 tag and of its optional footer. */
+    const size_t ID3V2_HEADER_SIZE = 10;
+    /** The first frame header is searched within this many bytes. */
+    const size_t SEARCH_SIZE = 4096;
+    /** Bit rates in kbit/s for MPEG 1 and MPEG 2/2.5, layer I, II and III. */
+    const uint32_t BIT_RATES[2][3][16] = {
+        {{0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416,
+          448, 0},
+         {0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 0},
+         {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0}},
+        {{0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256, 0},
+         {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0},
+         {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0}}
+    };
+    /** Sample rates of MPEG 1. MPEG 2 uses half, MPEG 2.5 a quarter of it. */
+    const uint32_t SAMPLE_RATES[3] = {44100, 48000, 32000};
+
+    /** The fields of a frame header that are needed to determine the
+     *  length. */
+    struct FrameHeader {
+        bool mpeg1;
+        bool mono;
+        uint32_t bitRate;
+        uint32_t sampleRate;
+        uint32_t samplesPerFrame;
+        uint32_t frameSize;
+    };
+    bool parseFrameHeader (const uint8_t* header, FrameHeader& frame) {
+        if (header[0] != 0xFF || (header[1] & 0xE0) != 0xE0) {
+            return false;
+        }
+        uint8_t version = (header[1] >> 3) & 0x03;
+        uint8_t layer = (header[1] >> 1) & 0x03;
+        uint8_t bitRateIndex = header[2] >> 4;
+        uint8_t sampleRateIndex = (header[2] >> 2) & 0x03;
+        if (version == 1 || layer == 0 || bitRateIndex == 0 ||
+            bitRateIndex == 15 || sampleRateIndex == 3) {
+            return false;
+        }
+        // Note: Version 3 is MPEG 1, 2 is MPEG 2 and 0 is MPEG 2.5. Layer 3
+        // is layer I, 2 is layer II and 1 is layer III.
+        frame.mpeg1 = (version == 3);
+        frame.mono = (header[3] >> 6) == 3;
+        frame.bitRate = 1000 *
+                BIT_RATES[frame.mpeg1 ? 0 : 1][3 - layer][bitRateIndex];
+        frame.sampleRate = SAMPLE_RATES[sampleRateIndex] >>
+                (frame.mpeg1 ? 0 : (version == 2) ? 1 : 2);
+        if (layer == 3) {
+            frame.samplesPerFrame = 384;
+        } else if (layer == 2 || frame.mpeg1) {
+            frame.samplesPerFrame = 1152;
+        } else {
+            frame.samplesPerFrame = 576;
+        }
+        uint32_t padding = (header[2] >> 1) & 0x01;
+        if (layer == 3) {
+            frame.frameSize = (12 * frame.bitRate / frame.sampleRate +
+                    padding) * 4;
+        } else {
+            frame.frameSize = frame.samplesPerFrame / 8 * frame.bitRate /
+                    frame.sampleRate + padding;
+        }
+        return true;
+    }
+    uint32_t readBigEndian (const uint8_t* bytes) {
+        return (static_cast<uint32_t>(bytes[0]) << 24) |
+               (static_cast<uint32_t>(bytes[1]) << 16) |
+               (static_cast<uint32_t>(bytes[2]) << 8) |
+                static_cast<uint32_t>(bytes[3]);
+    }
+    /**
+     * Get the number of frames from a Xing/Info or VBRI header in the given
+     * first frame.
+     * @return The number of frames or zero if there is no such header.
+     */
+    uint32_t readVbrFrameCount (const uint8_t* frameStart, size_t size,
+                                const FrameHeader& frame) {
+        // Note: The Xing header follows the side information, whose size
+        // depends on the version and the channel mode.
+        size_t xingOffset = 4 + (frame.mpeg1 ? (frame.mono ? 17 : 32) :
+                                               (frame.mono ? 9 : 17));
+        if (xingOffset + 12 <= size &&
+            (memcmp(frameStart + xingOffset, "Xing", 4) == 0 ||
+             memcmp(frameStart + xingOffset, "Info", 4) == 0) &&
+            (readBigEndian(frameStart + xingOffset + 4) & 0x01) != 0) {
+            return readBigEndian(frameStart + xingOffset + 8);
+        }
+        // Note: The VBRI header of the Fraunhofer encoder is always located
+        // 32 bytes after the frame header.
+        size_t vbriOffset = 4 + 32;
+        if (vbriOffset + 18 <= size &&
+            memcmp(frameStart + vbriOffset, "VBRI", 4) == 0) {
+            return readBigEndian(frameStart + vbriOffset + 14);
+        }
+        return 0;
+    }
+}
+
+//==============================================================================
+//------------------------------- Mp3Duration ----------------------------------
+//==============================================================================
+Mp3Duration::Mp3Duration()
+: _frameCount (0)
+, _milliseconds (0) {
+}
+Mp3Duration::Mp3Duration (uint32_t frameCount, uint32_t milliseconds)
+: _frameCount (frameCount)
+, _milliseconds (milliseconds) {
+}
+uint32_t Mp3Duration::getFrameCount() const {
+    return _frameCount;
+}
+uint32_t Mp3Duration::getMilliseconds() const {
+    return _milliseconds;
+}
+Mp3Duration Mp3Duration::read (int directoryFileDescriptor,
+                               const char* fileName) {
+    int fd = openat(directoryFileDescriptor, fileName, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return Mp3Duration();
+    }
+    struct stat status;
+    uint8_t buffer[SEARCH_SIZE];
+    off_t audioStart = 0;
+    ssize_t length = 0;
+    if (fstat(fd, &status) == 0) {
+        length = pread(fd, buffer, sizeof(buffer), 0);
+    }
+    if (length >= static_cast<ssize_t>(ID3V2_HEADER_SIZE) &&
+        memcmp(buffer, "ID3", 3) == 0) {
+        // Note: The size of the ID3v2 tag is stored as a syncsafe integer
+        // (7 bits per byte) and does not include the header and the footer.
+        audioStart = ID3V2_HEADER_SIZE +
+                ((buffer[6] & 0x7F) << 21 | (buffer[7] & 0x7F) << 14 |
+                 (buffer[8] & 0x7F) << 7 | (buffer[9] & 0x7F));
+        if (buffer[5] & 0x10) {
+            audioStart += ID3V2_HEADER_SIZE;
+        }
+        length = pread(fd, buffer, sizeof(buffer), audioStart);
+    }
+    close(fd);
+    // Note: A frame header is only accepted if the next frame header follows
+    // it (as far as it is within the buffer), since the sync pattern may
+    // appear in garbage in front of the first frame as well.
+    FrameHeader frame;
+    for (ssize_t i=0; i + 4 <= length; i++) {
+        if (!parseFrameHeader(buffer + i, frame)) {
+            continue;
+        }
+        FrameHeader nextFrame;
+        if (i + frame.frameSize + 4 <= static_cast<size_t>(length) &&
+            !parseFrameHeader(buffer + i + frame.frameSize, nextFrame)) {
+            continue;
+        }
+        uint64_t frameCount = readVbrFrameCount(buffer + i, length - i,
+                                                frame);
+        if (frameCount == 0) {
+            uint64_t audioSize = status.st_size - audioStart - i;
+            frameCount = audioSize * 8 * frame.sampleRate /
+                    (static_cast<uint64_t>(frame.bitRate) *
+                     frame.samplesPerFrame);
+        }
+        uint64_t milliseconds = frameCount * frame.samplesPerFrame * 1000 /
+                frame.sampleRate;
+        return Mp3Duration(frameCount, milliseconds);
+    }
+    return Mp3Duration();
+}
@@ -0,0 +1,54 @@
+#ifndef MP3_DURATION_HPP
+#define	MP3_DURATION_HPP
+
+#include <cstdint>
+
+/**
+ * The length of an mp3 file as number of frames and as duration. The length
+ * is determined without decoding the file: An ID3v2 tag at the beginning is
+ * skipped and the first frame header is read. If the first frame contains a
+ * Xing/Info or VBRI header (variable bit rate) the number of frames is taken
+ * from it, otherwise the number of frames is calculated from the size of the
+ * file (constant bit rate). Like this only the beginning of the file has to
+ * be read.
+ * The frames are counted the same way as mpg123 counts them, so a frame
+ * number can be passed to Mp3Player::jumpTo.
+ */
+class Mp3Duration {
+public:
+    /**
+     * Constructor for an unknown length. Both the frame count and the
+     * duration are zero.
+     */
+    Mp3Duration();
+    /**
+     * Constructor.
+     * @param frameCount The number of frames.
+     * @param milliseconds The duration in milliseconds.
+     */
+    Mp3Duration (std::uint32_t frameCount, std::uint32_t milliseconds);
+    /**
+     * Get the number of frames.
+     * @return The number of frames or zero if the length is unknown.
+     */
+    std::uint32_t getFrameCount() const;
+    /**
+     * Get the duration.
+     * @return The duration in milliseconds or zero if the length is unknown.
+     */
+    std::uint32_t getMilliseconds() const;
+    /**
+     * Determine the length of the given mp3 file.
+     * @param directoryFileDescriptor The directory containing the file.
+     * @param fileName The name of the file within the directory.
+     * @return The length of the file. Unknown if the file could not be read
+     *         or if no valid frame header has been found.
+     */
+    static Mp3Duration read (int directoryFileDescriptor, const char* fileName);
+
+private:
+    std::uint32_t _frameCount;
+    std::uint32_t _milliseconds;
+};
+
+#endif	/* MP3_DURATION_HPP */
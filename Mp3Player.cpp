@@ -1,4 +1,6 @@
 #include "Mp3Player.hpp"
+#include "ChildProgram.hpp"
+#include "PcmOutput.hpp"
 #include <wait.h>
 #include <iostream>
 #include <algorithm>
@@ -8,39 +10,98 @@
 #include <boost/filesystem.hpp>
 #include <boost/date_time/posix_time/posix_time_duration.hpp>
 #include <cstdlib>
+#include <sstream>
 
-using std::ostringstream;
-using std::istringstream;
 using std::string;
 using std::endl;
-using std::getline;
 using std::vector;
 using std::remove_if;
 using std::cout;
+using std::cerr;
+using std::to_string;
+using std::istringstream;
+using std::min;
+using std::max;
+using std::chrono::steady_clock;
+using std::chrono::duration_cast;
 using boost::bind;
 using boost::algorithm::trim_copy;
 using boost::optional;
 using boost::asio::io_service;
-using boost::asio::async_read_until;
 using boost::asio::deadline_timer;
+using boost::asio::async_write;
 using boost::asio::buffer;
 using boost::asio::placeholders::error;
 using boost::asio::placeholders::bytes_transferred;
 using boost::filesystem::path;
 using boost::posix_time::milliseconds;
+using boost::posix_time::time_duration;
 using boost::system::error_code;
 
-Mp3Player::Mp3Player(const std::string& executable,
-        io_service& ioService)
+namespace {
+    /**
+     * mpg123 reports the frame a seek has reached with the next @F message.
+     * Frames that are a little later are accepted as well, in case a frame
+     * has been decoded before the message was sent.
+     */
+    const int SEEK_TOLERANCE_FRAMES = 8;
+    /** Assumed until the stream information of the first title is known. */
+    const long DEFAULT_SAMPLE_RATE = 44100;
+    /** Assumed until the stream information of the first title is known. */
+    const long DEFAULT_SAMPLES_PER_FRAME = 1152;
+    /**
+     * While a title is played mpg123 has to report its status at least this
+     * often, in addition to the interval the status is sampled with. Else it
+     * is considered to hang.
+     */
+    const std::chrono::milliseconds WATCHDOG_TIMEOUT (2000);
+    /** The interval the watchdog checks the time of the last status in. */
+    const time_duration WATCHDOG_INTERVAL (milliseconds(1000));
+}
+
+Mp3Player::Mp3Player(const Decoder::Factory& createDecoder,
+        io_service& ioService, bool sampleStatus)
 : _waitForId3TagsTimer (ioService)
-, _mpg123Program (executable, vector<string>{"-m", "-R"}, ioService)
-, _in (_mpg123Program.in())
-, _out(_mpg123Program.out())
-, _err(_mpg123Program.err())
-, _loadCompleted (false)
+, _statusTimer (ioService)
+, _watchdogTimer (ioService)
+, _standbyListener (*this)
+, _decoder (createDecoder(*this))
+, _standbyDecoder (createDecoder(_standbyListener))
+, _promptListener (*this)
+, _promptDecoder (createDecoder(_promptListener))
+, _promptPlaying (false)
+, _pauseRequested (false)
+, _stopped (true)
+, _loadPending (false)
+, _loadStarted (false)
+, _readTags (true)
 , _jumpToFrameCount (0)
-, _jumpToCompleted (false) {
-    bindHandleInputMethod();
+, _seekInFlight (false)
+, _seekFrameCount (0)
+, _seekCount (0)
+, _droppedSeekCount (0)
+, _sampleStatus (sampleStatus)
+, _requestedSampleCount (0)
+, _playing (false)
+, _paused (false)
+, _statusFrameCount (0)
+, _statusFrameCountTotal (0)
+, _sampleRate (DEFAULT_SAMPLE_RATE)
+, _samplesPerFrame (DEFAULT_SAMPLES_PER_FRAME)
+, _watchdogRunning (false)
+, _recovering (false)
+, _recoveryCount (0)
+, _lastRecoveryTime (0)
+, _maxRecoveryTime (0)
+, _lastLoadTime (0)
+, _lastSeekTime (0) {
+    if (_sampleStatus) {
+        // Note: Turn off the @F messages mpg123 sends for every frame.
+        _decoder->silence();
+        _standbyDecoder->silence();
+    }
+    // Note: The progress of the prompts is of no interest.
+    _promptDecoder->silence();
 } 
 void Mp3Player::addListener (IListener* listener) {
     _listeners.push_back(listener);
@@ -49,163 +110,650 @@ void Mp3Player::removeListener (IListener* listener) {
     remove_if (_listeners.begin(), _listeners.end(),
             [listener](IListener* l){return l==listener;});
 }
-void Mp3Player::load(const path& mp3File) {
-    ostringstream oss;
-    oss << "LOAD " << mp3File.string() << endl;
-    string command = oss.str();
-    _in.write_some (buffer(command.c_str(), command.size()));
-    _loadCompleted = false;
+void Mp3Player::load(const path& mp3File, bool readTags,
+                     const CompletionHandler& loadCompleted) {
+    _waitForId3TagsTimer.cancel();
+    _loadCompletedHandler = loadCompleted;
+    _loadPending = true;
+    _loadStartTime = steady_clock::now();
+    _readTags = readTags;
+    _pauseRequested = false;
+    _stopped = false;
+    // Note: A sample requested while no title was playing is answered by an
+    // error instead, so it must not hold back the samples of this title.
+    _requestedSampleCount = 0;
+    stopPrompt();
+    if (_standbyListener.available && _standbyListener.title == mp3File.string()) {
+        swapDecoders();
+    } else {
+        _decoder->load(mp3File.string());
+        _id3TagParser = Id3TagParser();
+        _loadStarted = false;
+    }
+    _playing = false;
+    _paused = false;
+    // Note: Seeks of the previous title are obsolete.
+    cancelSeeks();
+    _jumpToCompletedHandler = CompletionHandler();
 }
-bool Mp3Player::isLoadCompleted() const {
-    return _loadCompleted;
+void Mp3Player::preload(const path& mp3File) {
+    if (!_standbyListener.available || _standbyListener.title == mp3File.string()) {
+        return;
+    }
+    _standbyListener.reset();
+    _standbyListener.title = mp3File.string();
+    _standbyDecoder->loadPaused(mp3File.string());
 }
-void Mp3Player::pause() {
-    static const string command = "PAUSE\n";
-    _in.write_some (buffer(command.c_str(), command.size()));
+void Mp3Player::pause(const CompletionHandler& pauseCompleted) {
+    _decoder->pause();
+    _pauseCompletedHandler = pauseCompleted;
+    _pauseRequested = !_pauseRequested;
+}
+void Mp3Player::setPaused (bool paused) {
+    // Note: PAUSE toggles, a title that has stopped is not paused anyway.
+    if (paused != _pauseRequested && !_stopped) {
+        pause();
+    }
+}
+bool Mp3Player::isPaused() const {
+    return _pauseRequested;
+}
+void Mp3Player::playPrompt (const path& prompt) {
+    setPaused(true);
+    if (_promptListener.available) {
+        _promptDecoder->load(prompt.string());
+        _promptPlaying = true;
+    } else {
+        promptEnded();
+    }
+}
+void Mp3Player::stopPrompt() {
+    if (_promptPlaying) {
+        _promptDecoder->stop();
+        _promptPlaying = false;
+    }
 }
 void Mp3Player::jumpToBegin() {
-    static const string command = "JUMP 0\n";
-    _in.write_some (buffer(command.c_str(), command.size()));
+    seek(0);
 }
-void Mp3Player::jumpTo(int frameCount) {
-    ostringstream command;
-    command << "JUMP " << frameCount << endl;
-    _in.write_some (buffer(command.str().c_str(), command.str().size()));
+void Mp3Player::jumpTo(int frameCount,
+                       const CompletionHandler& jumpToCompleted) {
+    seek(frameCount);
     _jumpToFrameCount = frameCount;
-    _jumpToCompleted = false;
+    _jumpToCompletedHandler = jumpToCompleted;
 }
-bool Mp3Player::isJumpToCompleted() const {
-    return _jumpToCompleted;
+int Mp3Player::getFrameCount() const {
+    if (!_playing) {
+        return _statusFrameCount;
+    }
+    // Note: Between two status messages the position is interpolated, which
+    // is most useful if the status is only sampled from time to time.
+    std::chrono::duration<double> elapsed = steady_clock::now() - _statusTime;
+    int frameCount = _statusFrameCount + static_cast<int>(
+            elapsed.count() * _sampleRate / _samplesPerFrame);
+    return min(frameCount, _statusFrameCountTotal);
+}
+void Mp3Player::setStatusInterval (const time_duration& interval) {
+    if (_sampleStatus) {
+        _statusInterval = interval;
+        bindHandleStatusTimer();
+    }
+}
+unsigned long Mp3Player::getSeekCount() const {
+    return _seekCount;
+}
+unsigned long Mp3Player::getDroppedSeekCount() const {
+    return _droppedSeekCount;
+}
+unsigned long Mp3Player::getRecoveryCount() const {
+    return _recoveryCount;
+}
+std::chrono::milliseconds Mp3Player::getLastRecoveryTime() const {
+    return _lastRecoveryTime;
+}
+std::chrono::milliseconds Mp3Player::getMaxRecoveryTime() const {
+    return _maxRecoveryTime;
+}
+std::chrono::microseconds Mp3Player::getLastLoadTime() const {
+    return _lastLoadTime;
+}
+std::chrono::microseconds Mp3Player::getLastSeekTime() const {
+    return _lastSeekTime;
+}
+unsigned long Mp3Player::getOutputUnderrunCount() const {
+    unsigned long underrunCount = 0;
+    for (const Decoder* decoder : {_decoder.get(), _standbyDecoder.get(),
+                                   _promptDecoder.get()}) {
+        if (const PcmOutput* output = decoder->getOutput()) {
+            underrunCount += output->getUnderrunCount();
+        }
+    }
+    return underrunCount;
+}
+std::chrono::microseconds Mp3Player::getOutputBufferedTime() const {
+    const PcmOutput* output = _decoder->getOutput();
+    return output ? output->getBufferedTime() : std::chrono::microseconds(0);
+}
+std::chrono::microseconds Mp3Player::getOutputLatency() const {
+    const PcmOutput* output = _decoder->getOutput();
+    return output ? output->getLatency() : std::chrono::microseconds(0);
+}
+unsigned long Mp3Player::getDroppedErrorByteCount() const {
+    return _decoder->getDroppedErrorByteCount() +
+           _standbyDecoder->getDroppedErrorByteCount() +
+           _promptDecoder->getDroppedErrorByteCount();
 }
 void Mp3Player::jumpBackward (int frames) {
-    ostringstream command;
-    command << "JUMP -" << frames << endl;
-    _in.write_some (buffer(command.str().c_str(), command.str().size()));
+    _decoder->jumpBy(-frames);
 }
 void Mp3Player::jumpForward (int frames) {
-    ostringstream command;
-    command << "JUMP +" << frames << endl;
-    _in.write_some (buffer(command.str().c_str(), command.str().size()));
-}
-void Mp3Player::bindHandleInputMethod() {
-    async_read_until(_out, _inputBuffer, '\n',
-            bind(&Mp3Player::handleReadInput, this, error,
-            bytes_transferred));
-}
-void Mp3Player::handleReadInput(const error_code& error, size_t length) {
-    if (!error) {
-        boost::asio::streambuf::const_buffers_type bufs = _inputBuffer.data();
-        string input (boost::asio::buffers_begin(bufs),
-                boost::asio::buffers_end(bufs));
-        _inputBuffer.consume(_inputBuffer.size());
-        istringstream issInput (input);
-        vector<string> messages;
-        string line;
-        while (getline (issInput, line, '\n')) {
-            messages.push_back(line);
-        }
-        for (string message : messages) {
-            size_t messagePos = string::npos;
-            if (message.length() < 3) {
-                continue;
-            }
-            if (messagePos = message.find(string ("@F")) != string::npos) {
-                istringstream iss (message.substr(messagePos+2));
-                int framecount;
-                int framesLeft;
-                float seconds;
-                float secondsLeft;
-                iss >> framecount;
-                iss >> framesLeft;
-                iss >> seconds;
-                iss >> secondsLeft;
-                if (framecount == _jumpToFrameCount) {
-                    _jumpToCompleted = true;
-                }
-                for (auto l : _listeners) {
-                    l->playStatus(framecount, framesLeft, seconds, secondsLeft);
-                }
-            } else if (messagePos = message.find(string ("@P")) != string::npos) {
-                istringstream iss (message.substr(messagePos+2));
-                int playingStatusCode = 0;
-                string reason;
-                iss >> playingStatusCode;
-                iss >> reason;
-                switch (playingStatusCode) {
-                    case 0:
-                        if (reason == "EOF") {
-                            for (auto l : _listeners) {
-                                l->playingStopped(true);
-                            }
-                        } else {
-                            for (auto l : _listeners) {
-                                l->playingStopped(false);
-                            }
-                        }
-                        break;
-                    case 1:
-                        for (auto l : _listeners) {
-                            l->playingPaused();
-                        }
-                        break;
-                    case 2:
-                        for (auto l : _listeners) {
-                            l->playingUnpaused();
-                        }
-                        break;
-                }
-            } else if (messagePos = message.find(string ("@I")) != string::npos) {
-                if (!_id3TagParser.isParsingStarted()) {
-                    // After the first status message has been received give
-                    // mpg123 200 milliseconds to send the rest of ID3 tags...
-                    _waitForId3TagsTimer.expires_from_now (milliseconds(200));
-                    _waitForId3TagsTimer.async_wait(bind(
-                            &Mp3Player::handleStatusMessages, this, error));
-                }
-                _id3TagParser.parse(message.substr(messagePos+2));
-            } else if (messagePos = message.find(string ("@R")) != string::npos) {
-                istringstream iss (message.substr(messagePos+2));
-                string mpg123;
-                string version;
-                iss >> mpg123;
-                iss >> version;
-                for (auto l : _listeners) {
-                    l->mpg123Version(version);
-                }
-            } else if (messagePos = message.find(string ("@E")) != string::npos) {
-                istringstream iss (message.substr(messagePos+2));
-                string errorMessage;
-                iss >> errorMessage;
-                for (auto l : _listeners) {
-                    l->playingErrorOccurred(errorMessage);
-                }
-            } else if (messagePos = message.find(string ("@S")) != string::npos) {
-                istringstream iss (message.substr(messagePos+2));
+    _decoder->jumpBy(frames);
+}
+void Mp3Player::versionReceived (const StringRef& version) {
+    for (auto l : _listeners) {
+        l->mpg123Version(version.to_string());
+    }
+}
+void Mp3Player::tagReceived (const StringRef& tag) {
+    if (!_loadPending) {
+        return;
+    }
+    startLoad();
+    if (_readTags) {
+        _id3TagParser.parse(tag.to_string());
+    }
+}
+void Mp3Player::streamInfoReceived (const StringRef& streamInfo) {
+    updateStreamInfo(streamInfo.to_string());
+    if (!_loadPending) {
+        return;
+    }
+    startLoad();
+    if (_sampleStatus) {
+        // Note: The load is completed by the status sampled at the first
+        // frame, which contains the frame counts of the title as well.
+        requestSample();
+    } else if (!_readTags) {
+        completeLoad();
+    }
+}
+void Mp3Player::frameReceived (int framecount, int framesLeft, float seconds,
+                               float secondsLeft) {
+    statusReceived(framecount, framesLeft, seconds, secondsLeft);
+}
+void Mp3Player::sampleReceived (long sample, long sampleCount) {
+    if (_requestedSampleCount > 0) {
+        _requestedSampleCount--;
+    }
+    long samplesLeft = sampleCount - sample;
+    statusReceived(sample / _samplesPerFrame, samplesLeft / _samplesPerFrame,
+                   static_cast<float>(sample) / _sampleRate,
+                   static_cast<float>(samplesLeft) / _sampleRate);
+}
+void Mp3Player::statusReceived (int framecount, int framesLeft, float seconds,
+                                float secondsLeft) {
+    _statusFrameCount = framecount;
+    _statusFrameCountTotal = framecount + framesLeft;
+    _statusTime = steady_clock::now();
+    _playing = !_paused;
+    if (_playing) {
+        startWatchdog();
+    }
+    // Note: The tags and the stream information are sent before the first
+    // frame of the loaded title, whereas frames received before them still
+    // belong to the previous title.
+    bool loadCompleted = _loadPending && _loadStarted;
+    if (loadCompleted) {
+        completeLoad(false /* handler called below */);
+    }
+    if (_recovering && !_loadPending) {
+        completeRecovery();
+    }
+    bool jumpToCompleted = _jumpToCompletedHandler &&
+            isSeekTarget(framecount, _jumpToFrameCount);
+    if (_seekInFlight && isSeekTarget(framecount, _seekFrameCount)) {
+        _seekInFlight = false;
+        _lastSeekTime = duration_cast<std::chrono::microseconds>(
+                steady_clock::now() - _seekStartTime);
+    }
+    for (auto l : _listeners) {
+        l->playStatus(framecount, framesLeft, seconds, secondsLeft);
+    }
+    // Note: The completion handlers are called after the listeners, so they
+    // already know the frame counts of the loaded title.
+    if (loadCompleted) {
+        callCompletionHandler(_loadCompletedHandler);
+    }
+    if (jumpToCompleted) {
+        callCompletionHandler(_jumpToCompletedHandler);
+    }
+    // Note: The listeners had the chance to replace the pending seek by one
+    // that is based on the position reached right now.
+    if (!_seekInFlight) {
+        writePendingSeek();
+    }
+}
+void Mp3Player::playStatusReceived (int statusCode, const StringRef& reason) {
+    switch (statusCode) {
+        case 0:
+            // Note: No @F message follows when playing has stopped.
+            cancelSeeks();
+            _playing = false;
+            _pauseRequested = false;
+            _stopped = true;
+            for (auto l : _listeners) {
+                l->playingStopped(reason == "EOF");
             }
-        }
-        bindHandleInputMethod();
-    } else {
-        if (error == boost::asio::error::misc_errors::eof) {
-            int returnStatus;    
-            waitpid(_mpg123Program.pid(), &returnStatus, 0);
+            break;
+        case 1:
+            // Note: No @F message follows while playing is paused, so the
+            // pending seek is not held back any longer.
+            writePendingSeek();
+            _seekInFlight = false;
+            _statusFrameCount = getFrameCount();
+            _playing = false;
+            _paused = true;
             for (auto l : _listeners) {
-                l->mpg123Terminated(returnStatus);
+                l->playingPaused();
             }
-        } else {
+            callCompletionHandler(_pauseCompletedHandler);
+            break;
+        case 2:
+            _statusTime = steady_clock::now();
+            _playing = true;
+            _paused = false;
+            startWatchdog();
             for (auto l : _listeners) {
-                l->mpg123CommunicationProblem(error);
+                l->playingUnpaused();
             }
+            callCompletionHandler(_pauseCompletedHandler);
+            break;
+    }
+}
+void Mp3Player::errorReceived (const StringRef& message) {
+    const string errorMessage = message.to_string();
+    for (auto l : _listeners) {
+        l->playingErrorOccurred(errorMessage);
+    }
+}
+void Mp3Player::seek (int frameCount) {
+    if (_seekInFlight) {
+        // Note: Only the latest target matters, mpg123 would otherwise work
+        // through a backlog of obsolete seeks.
+        if (_pendingSeekFrameCount) {
+            _droppedSeekCount++;
         }
+        _pendingSeekFrameCount = frameCount;
+        return;
+    }
+    if (_pendingSeekFrameCount) {
+        _pendingSeekFrameCount.reset();
+        _droppedSeekCount++;
     }
+    _decoder->jumpTo(frameCount);
+    if (_sampleStatus && !_loadPending) {
+        // Note: mpg123 answers in order, so the sample confirms the seek.
+        // While loading the sample requested with the stream information
+        // does this.
+        requestSample();
+    }
+    _seekInFlight = true;
+    _seekFrameCount = frameCount;
+    _seekStartTime = steady_clock::now();
+    _seekCount++;
 }
-void Mp3Player::handleStatusMessages(const error_code& error) {
-    if (!error) {
-        Mp3Title mp3Title = _id3TagParser.getMp3Title();
-        _loadCompleted = true;
-        for (auto l : _listeners) {
-            l->titleLoaded(mp3Title);
+void Mp3Player::writePendingSeek() {
+    if (_pendingSeekFrameCount) {
+        int frameCount = _pendingSeekFrameCount.get();
+        _pendingSeekFrameCount.reset();
+        _seekInFlight = false;
+        seek(frameCount);
+    }
+}
+void Mp3Player::cancelSeeks() {
+    if (_pendingSeekFrameCount) {
+        _pendingSeekFrameCount.reset();
+        _droppedSeekCount++;
+    }
+    _seekInFlight = false;
+}
+void Mp3Player::requestSample() {
+    _decoder->requestSample();
+    _requestedSampleCount++;
+}
+void Mp3Player::bindHandleStatusTimer() {
+    _statusTimer.expires_from_now(_statusInterval);
+    _statusTimer.async_wait(bind(&Mp3Player::handleStatusTimer, this,
+                                 error));
+}
+void Mp3Player::handleStatusTimer (const error_code& error) {
+    if (error) {
+        return;
+    }
+    if (_playing && _requestedSampleCount == 0) {
+        requestSample();
+    }
+    bindHandleStatusTimer();
+}
+void Mp3Player::communicationProblem (const error_code& error) {
+    cerr << "Communication with mpg123 failed: " << error.message() << endl;
+    recover();
+    for (auto l : _listeners) {
+        l->mpg123CommunicationProblem(error);
+    }
+    // Note: If the listeners did not load a title again, the recovery is
+    // completed by the new mpg123.
+    if (_recovering && !_loadPending) {
+        completeRecovery();
+    }
+}
+void Mp3Player::terminated (int waitpidStatus) {
+    cerr << "mpg123 terminated with status " << waitpidStatus << "." << endl;
+    recover();
+    for (auto l : _listeners) {
+        l->mpg123Terminated(waitpidStatus);
+    }
+    if (_recovering && !_loadPending) {
+        completeRecovery();
+    }
+}
+void Mp3Player::promptEnded() {
+    _promptPlaying = false;
+    for (auto l : _listeners) {
+        l->promptPlayed();
+    }
+}
+void Mp3Player::swapDecoders() {
+    // Note: The messages the stopped decoder still sends are ignored by the
+    // standby listener.
+    _decoder->stop();
+    _decoder->setListener(_standbyListener);
+    _standbyDecoder->setListener(*this);
+    _decoder.swap(_standbyDecoder);
+    // Note: The title has been loaded paused, PAUSE continues it.
+    _decoder->pause();
+    _id3TagParser = _readTags ? _standbyListener.id3TagParser :
+                                Id3TagParser();
+    if (!_standbyListener.streamInfo.empty()) {
+        updateStreamInfo(_standbyListener.streamInfo);
+    }
+    // Note: If the preloaded title already sent its tags or its stream
+    // information, the next status completes the load.
+    _loadStarted = false;
+    if (_standbyListener.started) {
+        startLoad();
+        if (_sampleStatus) {
+            requestSample();
         }
-        // Reset the tag parser by a clean one.
-        _id3TagParser = Id3TagParser();
+    }
+    _standbyListener.reset();
+}
+void Mp3Player::recover() {
+    if (!_recovering) {
+        _recovering = true;
+        _recoveryStartTime = steady_clock::now();
+    }
+    if (_standbyListener.available && _standbyDecoder->hasResponded()) {
+        // Note: The standby mpg123 is running already, so it takes over right
+        // away. The failed mpg123 is restarted as the new standby mpg123. A
+        // preloaded title is not stopped, since the status of STOP would be
+        // taken for the end of the current title. It is paused and replaced
+        // by the next load.
+        _standbyDecoder->setListener(*this);
+        _decoder->setListener(_standbyListener);
+        _decoder.swap(_standbyDecoder);
+        _standbyListener.reset();
+        _standbyListener.available = respawn(*_standbyDecoder, _sampleStatus);
+    } else if (!respawn(*_decoder, _sampleStatus)) {
+        _recovering = false;
+    }
+    // Note: The new mpg123 has not loaded any title yet.
+    _waitForId3TagsTimer.cancel();
+    _loadPending = false;
+    _loadStarted = false;
+    _id3TagParser = Id3TagParser();
+    _loadCompletedHandler = CompletionHandler();
+    _jumpToCompletedHandler = CompletionHandler();
+    _pauseCompletedHandler = CompletionHandler();
+    cancelSeeks();
+    _requestedSampleCount = 0;
+    _playing = false;
+    _paused = false;
+    _pauseRequested = false;
+    _stopped = true;
+}
+void Mp3Player::completeRecovery() {
+    _recovering = false;
+    _lastRecoveryTime = duration_cast<std::chrono::milliseconds>(
+            steady_clock::now() - _recoveryStartTime);
+    _maxRecoveryTime = max(_maxRecoveryTime, _lastRecoveryTime);
+    _recoveryCount++;
+    cout << "mpg123 recovered in " << _lastRecoveryTime.count() << " ms."
+         << endl;
+}
+bool Mp3Player::respawn (Decoder& decoder, bool silence) {
+    // Note: An mpg123 that did not even respond is not able to run at all,
+    // restarting it again and again would not help.
+    if (!decoder.hasResponded()) {
+        cerr << "mpg123 is not restarted, since it did not respond." << endl;
+        return false;
+    }
+    try {
+        decoder.restart();
+    } catch (const ChildProgram::CreationException& e) {
+        cerr << "Unable to restart mpg123: " << e.what() << endl;
+        return false;
+    }
+    if (silence) {
+        decoder.silence();
+    }
+    return true;
+}
+bool Mp3Player::isStatusExpected() const {
+    return _playing || (_loadPending && _loadStarted);
+}
+void Mp3Player::startWatchdog() {
+    // Note: The watchdog only runs while a status is expected, so it does not
+    // wake up the device while nothing is played.
+    if (!_watchdogRunning) {
+        _watchdogRunning = true;
+        bindHandleWatchdogTimer();
+    }
+}
+void Mp3Player::bindHandleWatchdogTimer() {
+    _watchdogTimer.expires_from_now(WATCHDOG_INTERVAL);
+    _watchdogTimer.async_wait(bind(&Mp3Player::handleWatchdogTimer, this,
+                                   error));
+}
+void Mp3Player::handleWatchdogTimer (const error_code& error) {
+    if (error || !isStatusExpected()) {
+        _watchdogRunning = false;
+        return;
+    }
+    std::chrono::milliseconds timeout = WATCHDOG_TIMEOUT;
+    if (_sampleStatus) {
+        timeout += std::chrono::milliseconds(
+                _statusInterval.total_milliseconds());
+    }
+    if (steady_clock::now() - _statusTime > timeout) {
+        _watchdogRunning = false;
+        // Note: The recovery kills the hanging mpg123.
+        communicationProblem(boost::asio::error::timed_out);
+        return;
+    }
+    bindHandleWatchdogTimer();
+}
+void Mp3Player::updateStreamInfo (const string& streamInfo) {
+    // Note: The stream information starts with the MPEG version, the layer
+    // and the sample rate, e.g. "1.0 3 44100 Joint-Stereo ...".
+    istringstream iss (streamInfo);
+    string version;
+    int layer = 0;
+    long sampleRate = 0;
+    iss >> version >> layer >> sampleRate;
+    if (sampleRate > 0) {
+        _sampleRate = sampleRate;
+        if (layer == 1) {
+            _samplesPerFrame = 384;
+        } else if (layer == 2 || version == "1.0") {
+            _samplesPerFrame = 1152;
+        } else {
+            _samplesPerFrame = 576;
+        }
+    }
+}
+void Mp3Player::startLoad() {
+    if (!_loadStarted) {
+        _loadStarted = true;
+        // Note: From now on the first frame is expected.
+        _statusTime = steady_clock::now();
+        startWatchdog();
+        // Normally the load is completed by the first frame. Just in case it
+        // is not sent give mpg123 200 milliseconds to send the ID3 tags...
+        _waitForId3TagsTimer.expires_from_now (milliseconds(200));
+        _waitForId3TagsTimer.async_wait(bind(
+                &Mp3Player::handleStatusMessages, this, error));
+    }
+}
+void Mp3Player::completeLoad(bool callHandler) {
+    _waitForId3TagsTimer.cancel();
+    _loadPending = false;
+    _lastLoadTime = duration_cast<std::chrono::microseconds>(
+            steady_clock::now() - _loadStartTime);
+    Mp3Title mp3Title = _id3TagParser.getMp3Title();
+    // Reset the tag parser by a clean one.
+    _id3TagParser = Id3TagParser();
+    for (auto l : _listeners) {
+        l->titleLoaded(mp3Title);
+    }
+    if (callHandler) {
+        callCompletionHandler(_loadCompletedHandler);
+    }
+}
+void Mp3Player::handleStatusMessages(const error_code& error) {
+    if (!error && _loadPending) {
+        completeLoad();
+    }
+}
+bool Mp3Player::isSeekTarget (int framecount, int targetFrameCount) {
+    return framecount >= targetFrameCount &&
+           framecount <= targetFrameCount + SEEK_TOLERANCE_FRAMES;
+}
+void Mp3Player::callCompletionHandler (CompletionHandler& handler) {
+    // Note: The handler is reset before it is called, since it may start
+    // the next command with a new handler right away.
+    CompletionHandler completed;
+    completed.swap(handler);
+    if (completed) {
+        completed();
+    }
+}
+
+//==============================================================================
+//------------------------ Mp3Player::StandbyListener --------------------------
+//==============================================================================
+Mp3Player::StandbyListener::StandbyListener (Mp3Player& mp3Player)
+: available (true)
+, started (false)
+, _mp3Player (mp3Player) {
+}
+void Mp3Player::StandbyListener::reset() {
+    title.clear();
+    id3TagParser = Id3TagParser();
+    streamInfo.clear();
+    started = false;
+}
+void Mp3Player::StandbyListener::versionReceived (const StringRef& version) {
+}
+void Mp3Player::StandbyListener::tagReceived (const StringRef& tag) {
+    if (!title.empty()) {
+        started = true;
+        id3TagParser.parse(tag.to_string());
+    }
+}
+void Mp3Player::StandbyListener::streamInfoReceived (
+        const StringRef& streamInfo) {
+    if (!title.empty()) {
+        started = true;
+        this->streamInfo = streamInfo.to_string();
+    }
+}
+void Mp3Player::StandbyListener::frameReceived (int framecount,
+        int framesLeft, float seconds, float secondsLeft) {
+}
+void Mp3Player::StandbyListener::sampleReceived (long sample,
+                                                 long sampleCount) {
+}
+void Mp3Player::StandbyListener::playStatusReceived (int statusCode,
+        const StringRef& reason) {
+}
+void Mp3Player::StandbyListener::errorReceived (const StringRef& message) {
+    if (!title.empty()) {
+        cerr << "Unable to preload " << title << ": " << message << endl;
+        reset();
+    }
+}
+void Mp3Player::StandbyListener::communicationProblem (
+        const error_code& error) {
+    cerr << "Standby mpg123 not available: " << error.message() << endl;
+    reset();
+    available = _mp3Player.respawn(*_mp3Player._standbyDecoder,
+                                   _mp3Player._sampleStatus);
+}
+void Mp3Player::StandbyListener::terminated (int waitpidStatus) {
+    cerr << "Standby mpg123 terminated." << endl;
+    reset();
+    available = _mp3Player.respawn(*_mp3Player._standbyDecoder,
+                                   _mp3Player._sampleStatus);
+}
+
+//==============================================================================
+//------------------------- Mp3Player::PromptListener --------------------------
+//==============================================================================
+Mp3Player::PromptListener::PromptListener (Mp3Player& mp3Player)
+: available (true)
+, _mp3Player (mp3Player) {
+}
+void Mp3Player::PromptListener::versionReceived (const StringRef& version) {
+}
+void Mp3Player::PromptListener::tagReceived (const StringRef& tag) {
+}
+void Mp3Player::PromptListener::streamInfoReceived (
+        const StringRef& streamInfo) {
+}
+void Mp3Player::PromptListener::frameReceived (int framecount,
+        int framesLeft, float seconds, float secondsLeft) {
+}
+void Mp3Player::PromptListener::sampleReceived (long sample,
+                                                long sampleCount) {
+}
+void Mp3Player::PromptListener::playStatusReceived (int statusCode,
+        const StringRef& reason) {
+    // Note: A prompt that has been stopped or replaced does not end with EOF.
+    if (statusCode == 0 && reason == "EOF" && _mp3Player._promptPlaying) {
+        _mp3Player.promptEnded();
+    }
+}
+void Mp3Player::PromptListener::errorReceived (const StringRef& message) {
+    cerr << "Unable to play prompt: " << message << endl;
+    if (_mp3Player._promptPlaying) {
+        _mp3Player.promptEnded();
+    }
+}
+void Mp3Player::PromptListener::communicationProblem (
+        const error_code& error) {
+    cerr << "Prompt mpg123 not available: " << error.message() << endl;
+    available = _mp3Player.respawn(*_mp3Player._promptDecoder,
+                                   true /* silence */);
+    if (_mp3Player._promptPlaying) {
+        _mp3Player.promptEnded();
+    }
+}
+void Mp3Player::PromptListener::terminated (int waitpidStatus) {
+    cerr << "Prompt mpg123 terminated." << endl;
+    available = _mp3Player.respawn(*_mp3Player._promptDecoder,
+                                   true /* silence */);
+    if (_mp3Player._promptPlaying) {
+        _mp3Player.promptEnded();
     }
 }
@@ -1,11 +1,14 @@
 #ifndef MP3PLAYER_HPP
 #define	MP3PLAYER_HPP
 
-#include "ChildProgram.hpp"
 #include "Id3TagParser.hpp"
 #include "Mp3Title.hpp"
-#include <boost/asio/streambuf.hpp>
+#include "Decoder.hpp"
 #include <boost/asio/deadline_timer.hpp>
+#include <boost/optional.hpp>
+#include <chrono>
+#include <functional>
+#include <memory>
 
 namespace boost {
     namespace asio {
@@ -19,8 +22,10 @@ namespace boost {
     }
 }
 
-class Mp3Player {
+class Mp3Player : public virtual Decoder::IListener {
 public:
+    typedef Mpg123Parser::StringRef StringRef;
+    typedef std::function<void()> CompletionHandler;
    class IListener {
     public:
         virtual ~IListener() {}
@@ -35,37 +40,163 @@ public:
         virtual void mpg123CommunicationProblem (
             const boost::system::error_code& error) = 0;
         virtual void mpg123Terminated (int waitpidStatus) = 0;
+        virtual void promptPlayed() = 0;
     };
-    Mp3Player (const std::string& executable,
-        boost::asio::io_service& ioService);
+    Mp3Player (const Decoder::Factory& createDecoder,
+        boost::asio::io_service& ioService, bool sampleStatus = false);
     void addListener (IListener* listener);
     void removeListener (IListener* listener);
-    void load (const boost::filesystem::path& mp3File);
-    bool isLoadCompleted() const;
-    void pause();
+    void load (const boost::filesystem::path& mp3File, bool readTags = true,
+               const CompletionHandler& loadCompleted = CompletionHandler());
+    void preload (const boost::filesystem::path& mp3File);
+    void pause (const CompletionHandler& pauseCompleted = CompletionHandler());
+    void setPaused (bool paused);
+    bool isPaused() const;
+    void playPrompt (const boost::filesystem::path& prompt);
+    void stopPrompt();
     void jumpToBegin();
-    void jumpTo(int frameCount);
-    bool isJumpToCompleted() const;
+    void jumpTo (int frameCount,
+                 const CompletionHandler& jumpToCompleted = CompletionHandler());
+    int getFrameCount() const;
+    void setStatusInterval (const boost::posix_time::time_duration& interval);
+    unsigned long getSeekCount() const;
+    unsigned long getDroppedSeekCount() const;
+    unsigned long getRecoveryCount() const;
+    std::chrono::milliseconds getLastRecoveryTime() const;
+    std::chrono::milliseconds getMaxRecoveryTime() const;
+    unsigned long getDroppedErrorByteCount() const;
+    std::chrono::microseconds getLastLoadTime() const;
+    std::chrono::microseconds getLastSeekTime() const;
+    unsigned long getOutputUnderrunCount() const;
+    std::chrono::microseconds getOutputBufferedTime() const;
+    std::chrono::microseconds getOutputLatency() const;
     void jumpBackward (int frames);
     void jumpForward (int frames);
+    void versionReceived (const StringRef& version) override;
+    void tagReceived (const StringRef& tag) override;
+    void streamInfoReceived (const StringRef& streamInfo) override;
+    void frameReceived (int framecount, int framesLeft, float seconds,
+                        float secondsLeft) override;
+    void sampleReceived (long sample, long sampleCount) override;
+    void playStatusReceived (int statusCode, const StringRef& reason) override;
+    void errorReceived (const StringRef& message) override;
+    void communicationProblem (const boost::system::error_code& error) override;
+    void terminated (int waitpidStatus) override;
 
 protected:
-    void bindHandleInputMethod();
-    void handleReadInput(const boost::system::error_code& error, size_t length);
+    class StandbyListener : public virtual Decoder::IListener {
+    public:
+        StandbyListener (Mp3Player& mp3Player);
+        void reset();
+        void versionReceived (const StringRef& version) override;
+        void tagReceived (const StringRef& tag) override;
+        void streamInfoReceived (const StringRef& streamInfo) override;
+        void frameReceived (int framecount, int framesLeft, float seconds,
+                            float secondsLeft) override;
+        void sampleReceived (long sample, long sampleCount) override;
+        void playStatusReceived (int statusCode,
+                                 const StringRef& reason) override;
+        void errorReceived (const StringRef& message) override;
+        void communicationProblem (
+                const boost::system::error_code& error) override;
+        void terminated (int waitpidStatus) override;
+        bool available;
+        std::string title;
+        Id3TagParser id3TagParser;
+        std::string streamInfo;
+        bool started;
+    private:
+        Mp3Player& _mp3Player;
+    };
+    class PromptListener : public virtual Decoder::IListener {
+    public:
+        PromptListener (Mp3Player& mp3Player);
+        void versionReceived (const StringRef& version) override;
+        void tagReceived (const StringRef& tag) override;
+        void streamInfoReceived (const StringRef& streamInfo) override;
+        void frameReceived (int framecount, int framesLeft, float seconds,
+                            float secondsLeft) override;
+        void sampleReceived (long sample, long sampleCount) override;
+        void playStatusReceived (int statusCode,
+                                 const StringRef& reason) override;
+        void errorReceived (const StringRef& message) override;
+        void communicationProblem (
+                const boost::system::error_code& error) override;
+        void terminated (int waitpidStatus) override;
+        bool available;
+    private:
+        Mp3Player& _mp3Player;
+    };
+    void promptEnded();
+    void swapDecoders();
+    void recover();
+    void completeRecovery();
+    bool respawn (Decoder& decoder, bool silence);
+    bool isStatusExpected() const;
+    void startWatchdog();
+    void bindHandleWatchdogTimer();
+    void handleWatchdogTimer (const boost::system::error_code& error);
+    void updateStreamInfo (const std::string& streamInfo);
+    void statusReceived (int framecount, int framesLeft, float seconds,
+                         float secondsLeft);
+    void seek (int frameCount);
+    void writePendingSeek();
+    void cancelSeeks();
+    void requestSample();
+    void bindHandleStatusTimer();
+    void handleStatusTimer (const boost::system::error_code& error);
+    void startLoad();
+    void completeLoad (bool callHandler = true);
     void handleStatusMessages(const boost::system::error_code& error);
+    static bool isSeekTarget (int framecount, int targetFrameCount);
+    static void callCompletionHandler (CompletionHandler& handler);
     
 private:
     boost::asio::deadline_timer _waitForId3TagsTimer;
-    const ChildProgram _mpg123Program;
-    boost::asio::posix::stream_descriptor _in;
-    boost::asio::posix::stream_descriptor _out;
-    boost::asio::posix::stream_descriptor _err;
-    boost::asio::streambuf _inputBuffer;
+    boost::asio::deadline_timer _statusTimer;
+    boost::asio::deadline_timer _watchdogTimer;
+    StandbyListener _standbyListener;
+    std::unique_ptr<Decoder> _decoder;
+    std::unique_ptr<Decoder> _standbyDecoder;
+    PromptListener _promptListener;
+    std::unique_ptr<Decoder> _promptDecoder;
+    bool _promptPlaying;
+    bool _pauseRequested;
+    bool _stopped;
     std::vector<IListener*> _listeners;
     Id3TagParser _id3TagParser;
-    bool _loadCompleted;
+    bool _loadPending;
+    bool _loadStarted;
+    bool _readTags;
+    CompletionHandler _loadCompletedHandler;
+    CompletionHandler _jumpToCompletedHandler;
+    CompletionHandler _pauseCompletedHandler;
     int _jumpToFrameCount;
-    bool _jumpToCompleted;
+    bool _seekInFlight;
+    int _seekFrameCount;
+    boost::optional<int> _pendingSeekFrameCount;
+    unsigned long _seekCount;
+    unsigned long _droppedSeekCount;
+    const bool _sampleStatus;
+    boost::posix_time::time_duration _statusInterval;
+    int _requestedSampleCount;
+    bool _playing;
+    bool _paused;
+    int _statusFrameCount;
+    int _statusFrameCountTotal;
+    std::chrono::steady_clock::time_point _statusTime;
+    long _sampleRate;
+    long _samplesPerFrame;
+    bool _watchdogRunning;
+    bool _recovering;
+    std::chrono::steady_clock::time_point _recoveryStartTime;
+    unsigned long _recoveryCount;
+    std::chrono::milliseconds _lastRecoveryTime;
+    std::chrono::milliseconds _maxRecoveryTime;
+    std::chrono::steady_clock::time_point _loadStartTime;
+    std::chrono::microseconds _lastLoadTime;
+    std::chrono::steady_clock::time_point _seekStartTime;
+    std::chrono::microseconds _lastSeekTime;
 };
 
 #endif	/* MP3PLAYER_HPP */
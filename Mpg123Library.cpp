@@ -0,0 +1,414 @@
+#ifdef USE_LIBMPG123
+
+#include "Mpg123Library.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <boost/asio.hpp>
+#include <boost/bind.hpp>
+#include <boost/filesystem/path.hpp>
+#include <mpg123.h>
+#include <out123.h>
+
+using std::string;
+using std::to_string;
+using std::unique_ptr;
+using std::unique_lock;
+using std::lock_guard;
+using std::mutex;
+using std::min;
+using std::max;
+using std::runtime_error;
+using boost::bind;
+using boost::asio::io_service;
+using boost::asio::buffer_cast;
+using boost::asio::buffer_size;
+using boost::asio::mutable_buffers_1;
+
+namespace {
+    const char* const VERSIONS[] = {"1.0", "2.0", "2.5"};
+    const char* const MODES[] = {"Stereo", "Joint-Stereo", "Dual-Channel",
+                                 "Single-Channel"};
+
+    void appendTag (const char* name, string text, string& messages) {
+        if (text.empty()) {
+            return;
+        }
+        // Note: A line break would end the message.
+        std::replace(text.begin(), text.end(), '\n', ' ');
+        messages += "@I ID3v2.";
+        messages += name;
+        messages += ':';
+        messages += text;
+        messages += '\n';
+    }
+    void appendTag (const char* name, const mpg123_string* value,
+                    string& messages) {
+        if (value != nullptr && value->fill > 0) {
+            appendTag(name, string(value->p), messages);
+        }
+    }
+    void appendTag (const char* name, const char* value, size_t size,
+                    string& messages) {
+        appendTag(name, string(value, strnlen(value, size)), messages);
+    }
+}
+
+//==============================================================================
+//------------------------------ Mpg123Library ---------------------------------
+//==============================================================================
+Mpg123Library::Mpg123Library (io_service& ioService, IListener& listener)
+: _ioService (ioService)
+, _parser (listener)
+, _handle (nullptr)
+, _output (nullptr)
+, _terminating (false)
+, _generation (0)
+, _outputOpen (false)
+, _open (false)
+, _paused (false)
+, _silent (false) {
+    // Note: Initializing the library more than once is harmless.
+    mpg123_init();
+    int result = MPG123_OK;
+    _handle = mpg123_new(nullptr, &result);
+    if (_handle == nullptr) {
+        throw runtime_error (string("Unable to create mpg123 decoder: ") +
+                             mpg123_plain_strerror(result));
+    }
+    mpg123_param(_handle, MPG123_ADD_FLAGS, MPG123_QUIET, 0.0);
+    _output = out123_new();
+    if (_output == nullptr) {
+        mpg123_delete(_handle);
+        throw runtime_error ("Unable to create out123 output.");
+    }
+    _thread = std::thread (&Mpg123Library::run, this);
+}
+Mpg123Library::~Mpg123Library() {
+    {
+        lock_guard<mutex> lock (_mutex);
+        _terminating = true;
+    }
+    _commandQueued.notify_one();
+    _thread.join();
+    close();
+    out123_del(_output);
+    mpg123_delete(_handle);
+}
+Decoder::Factory Mpg123Library::factory (io_service& ioService) {
+    return [&ioService](IListener& listener) {
+        return unique_ptr<Decoder> (new Mpg123Library (ioService, listener));
+    };
+}
+void Mpg123Library::setListener (IListener& listener) {
+    _parser.setListener(listener);
+}
+void Mpg123Library::load (const string& path) {
+    queueCommand(Command::LOAD, path);
+}
+void Mpg123Library::loadPaused (const string& path) {
+    queueCommand(Command::LOAD_PAUSED, path);
+}
+void Mpg123Library::pause() {
+    queueCommand(Command::PAUSE);
+}
+void Mpg123Library::stop() {
+    queueCommand(Command::STOP);
+}
+void Mpg123Library::jumpTo (int frameCount) {
+    queueCommand(Command::JUMP, string(), frameCount);
+}
+void Mpg123Library::jumpBy (int frames) {
+    queueCommand(Command::JUMP_BY, string(), frames);
+}
+void Mpg123Library::requestSample() {
+    queueCommand(Command::SAMPLE);
+}
+void Mpg123Library::silence() {
+    queueCommand(Command::SILENCE);
+}
+void Mpg123Library::restart() {
+    {
+        lock_guard<mutex> lock (_mutex);
+        // Note: The messages that are on their way to the io_service are
+        // ignored due to the new generation.
+        _generation++;
+        _commands.clear();
+        _commands.push_back(Command {Command::RESTART, string(), 0});
+    }
+    _parser.reset();
+    _commandQueued.notify_one();
+}
+void Mpg123Library::kill() {
+}
+bool Mpg123Library::hasResponded() const {
+    return true;
+}
+unsigned long Mpg123Library::getDroppedErrorByteCount() const {
+    return 0;
+}
+const PcmOutput* Mpg123Library::getOutput() const {
+    return nullptr;
+}
+void Mpg123Library::queueCommand (Command::Type type, const string& path,
+                                  int frames) {
+    {
+        lock_guard<mutex> lock (_mutex);
+        _commands.push_back(Command {type, path, frames});
+    }
+    _commandQueued.notify_one();
+}
+void Mpg123Library::run() {
+    string messages;
+    appendVersion(messages);
+    unique_lock<mutex> lock (_mutex);
+    postMessages(messages, _generation);
+    while (!_terminating) {
+        unsigned int generation = _generation;
+        messages.clear();
+        if (!_commands.empty()) {
+            Command command = _commands.front();
+            _commands.pop_front();
+            lock.unlock();
+            execute(command, messages);
+        } else if (_open && !_paused) {
+            // Note: Playing the frame blocks until the output has room for
+            // it, so the commands are checked once per frame.
+            lock.unlock();
+            decodeFrame(messages);
+        } else {
+            _commandQueued.wait(lock);
+            continue;
+        }
+        postMessages(messages, generation);
+        lock.lock();
+    }
+}
+void Mpg123Library::execute (const Command& command, string& messages) {
+    switch (command.type) {
+        case Command::LOAD:
+        case Command::LOAD_PAUSED:
+            open(command.path, command.type == Command::LOAD_PAUSED,
+                 messages);
+            break;
+        case Command::PAUSE:
+            if (_open) {
+                _paused = !_paused;
+                if (_paused) {
+                    out123_pause(_output);
+                    messages += "@P 1\n";
+                } else {
+                    out123_continue(_output);
+                    messages += "@P 2\n";
+                }
+            }
+            break;
+        case Command::STOP:
+            close();
+            messages += "@P 0\n";
+            break;
+        case Command::JUMP:
+        case Command::JUMP_BY:
+            if (_open) {
+                off_t frame = command.frames;
+                if (command.type == Command::JUMP_BY) {
+                    frame += mpg123_tellframe(_handle);
+                }
+                if (mpg123_seek_frame(_handle, max<off_t>(frame, 0),
+                                      SEEK_SET) < 0) {
+                    appendError(messages);
+                } else {
+                    // Note: The audio of the former position that is still
+                    // buffered must not be heard any more.
+                    out123_drop(_output);
+                    if (!_silent) {
+                        appendFrameStatus(messages);
+                    }
+                }
+            }
+            break;
+        case Command::SAMPLE:
+            if (_open) {
+                messages += "@SAMPLE " + to_string(mpg123_tell(_handle)) +
+                            " " + to_string(mpg123_length(_handle)) + "\n";
+            } else {
+                messages += "@E No stream opened.\n";
+            }
+            break;
+        case Command::SILENCE:
+            _silent = true;
+            messages += "@silence\n";
+            break;
+        case Command::RESTART:
+            close();
+            _silent = false;
+            appendVersion(messages);
+            break;
+    }
+}
+void Mpg123Library::decodeFrame (string& messages) {
+    off_t frame;
+    unsigned char* audio;
+    size_t size;
+    int result = mpg123_decode_frame(_handle, &frame, &audio, &size);
+    if (result == MPG123_NEW_FORMAT) {
+        out123_drain(_output);
+        out123_stop(_output);
+        if (!startOutput(messages)) {
+            close();
+            messages += "@P 0\n";
+        }
+        return;
+    } else if (result == MPG123_DONE) {
+        out123_drain(_output);
+        close();
+        messages += "@P 0 EOF\n";
+        return;
+    } else if (result != MPG123_OK) {
+        appendError(messages);
+        close();
+        messages += "@P 0\n";
+        return;
+    }
+    out123_play(_output, audio, size);
+    if (!_silent) {
+        appendFrameStatus(messages);
+    }
+}
+void Mpg123Library::open (const string& path, bool paused, string& messages) {
+    close();
+    if (!_outputOpen) {
+        if (out123_open(_output, nullptr, nullptr) != 0) {
+            messages += string("@E ") + out123_strerror(_output) + "\n";
+            return;
+        }
+        _outputOpen = true;
+    }
+    if (mpg123_open(_handle, path.c_str()) != MPG123_OK) {
+        appendError(messages);
+        return;
+    }
+    _open = true;
+    if (!startOutput(messages)) {
+        close();
+        return;
+    }
+    // Note: Determining the format has parsed the tags at the beginning of
+    // the title and the header of the first frame.
+    appendTags(path, messages);
+    appendStreamInfo(messages);
+    _paused = paused;
+    if (_paused) {
+        out123_pause(_output);
+        messages += "@P 1\n";
+    }
+}
+void Mpg123Library::close() {
+    if (_open) {
+        mpg123_close(_handle);
+        out123_drop(_output);
+        out123_stop(_output);
+        _open = false;
+        _paused = false;
+    }
+}
+bool Mpg123Library::startOutput (string& messages) {
+    long rate;
+    int channels;
+    int encoding;
+    if (mpg123_getformat(_handle, &rate, &channels, &encoding) != MPG123_OK) {
+        appendError(messages);
+        return false;
+    }
+    if (out123_start(_output, rate, channels, encoding) != 0) {
+        messages += string("@E ") + out123_strerror(_output) + "\n";
+        return false;
+    }
+    return true;
+}
+void Mpg123Library::appendVersion (string& messages) const {
+    messages += "@R libmpg123 API-" + to_string(MPG123_API_VERSION) + "\n";
+}
+void Mpg123Library::appendTags (const string& path, string& messages) const {
+    mpg123_id3v1* v1 = nullptr;
+    mpg123_id3v2* v2 = nullptr;
+    if (mpg123_id3(_handle, &v1, &v2) != MPG123_OK ||
+        (v1 == nullptr && v2 == nullptr)) {
+        // Note: Without tags mpg123 reports the name of the file.
+        messages += "@I " + boost::filesystem::path(path).stem().string() +
+                    "\n";
+    } else if (v2 != nullptr) {
+        appendTag("title", v2->title, messages);
+        appendTag("artist", v2->artist, messages);
+        appendTag("album", v2->album, messages);
+        appendTag("year", v2->year, messages);
+        appendTag("comment", v2->comment, messages);
+        appendTag("genre", v2->genre, messages);
+    } else {
+        // Note: The fields of ID3v1 are reported like those of ID3v2, which
+        // saves the fixed width layout mpg123 uses for them.
+        appendTag("title", v1->title, sizeof(v1->title), messages);
+        appendTag("artist", v1->artist, sizeof(v1->artist), messages);
+        appendTag("album", v1->album, sizeof(v1->album), messages);
+        appendTag("year", v1->year, sizeof(v1->year), messages);
+        appendTag("comment", v1->comment, sizeof(v1->comment), messages);
+    }
+}
+void Mpg123Library::appendStreamInfo (string& messages) const {
+    struct mpg123_frameinfo info;
+    if (mpg123_info(_handle, &info) != MPG123_OK) {
+        appendError(messages);
+        return;
+    }
+    // Note: The same fields as mpg123 reports by @S, e.g.
+    // "1.0 3 44100 Joint-Stereo 0 417 2 0 0 0 128 0 1".
+    char streamInfo[128];
+    snprintf(streamInfo, sizeof(streamInfo),
+             "@S %s %d %ld %s %d %d %d %d %d %d %d %d %d\n",
+             VERSIONS[info.version], info.layer, info.rate, MODES[info.mode],
+             info.mode_ext, info.framesize,
+             info.mode == MPG123_M_MONO ? 1 : 2,
+             (info.flags & MPG123_COPYRIGHT) ? 1 : 0,
+             (info.flags & MPG123_CRC) ? 1 : 0, info.emphasis, info.bitrate,
+             (info.flags & MPG123_PRIVATE) ? 1 : 0, info.vbr);
+    messages += streamInfo;
+}
+void Mpg123Library::appendFrameStatus (string& messages) const {
+    off_t frame = mpg123_tellframe(_handle);
+    off_t framesLeft = max<off_t>(mpg123_framelength(_handle) - frame, 0);
+    double secondsPerFrame = mpg123_tpf(_handle);
+    char status[96];
+    snprintf(status, sizeof(status), "@F %ld %ld %.2f %.2f\n",
+             static_cast<long>(frame), static_cast<long>(framesLeft),
+             frame * secondsPerFrame, framesLeft * secondsPerFrame);
+    messages += status;
+}
+void Mpg123Library::appendError (string& messages) const {
+    messages += string("@E ") + mpg123_strerror(_handle) + "\n";
+}
+void Mpg123Library::postMessages (const string& messages,
+                                  unsigned int generation) {
+    if (!messages.empty()) {
+        _ioService.post(bind(&Mpg123Library::handleMessages, this, messages,
+                             generation));
+    }
+}
+void Mpg123Library::handleMessages (const string& messages,
+                                    unsigned int generation) {
+    // Note: The generation is only changed in the io_service, so it is read
+    // without the mutex.
+    if (generation != _generation) {
+        return;
+    }
+    size_t offset = 0;
+    while (offset < messages.size()) {
+        mutable_buffers_1 free = _parser.prepare();
+        size_t length = min(buffer_size(free), messages.size() - offset);
+        memcpy(buffer_cast<char*>(free), messages.data() + offset, length);
+        _parser.commit(length);
+        offset += length;
+    }
+}
+
+#endif	/* USE_LIBMPG123 */
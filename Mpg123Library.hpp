@@ -0,0 +1,126 @@
+#ifndef MPG123_LIBRARY_HPP
+#define	MPG123_LIBRARY_HPP
+
+#include "Decoder.hpp"
+#include "Mpg123Parser.hpp"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace boost {
+    namespace asio {
+        class io_service;
+    }
+}
+struct mpg123_handle_struct;
+struct out123_struct;
+
+/**
+ * A decoder that runs libmpg123 and libout123 in a thread of this program,
+ * so no mpg123 has to be started and no pipe is in between. The commands
+ * are handed over to the thread by a queue, the thread reports in the same
+ * messages as mpg123 in remote control mode does. The messages are parsed
+ * in the io_service, so the listener is called there as for Mpg123Process.
+ *
+ * Only available if the program is built with USE_LIBMPG123.
+ */
+class Mpg123Library : public Decoder {
+public:
+    /**
+     * Constructor. Starts the thread that decodes the titles.
+     * @param ioService The io_service the listener is called in.
+     * @param listener The receiver of the messages.
+     * @exception std::runtime_error Thrown if libmpg123 or libout123 could
+     *            not be initialized.
+     */
+    Mpg123Library (boost::asio::io_service& ioService, IListener& listener);
+    Mpg123Library (const Mpg123Library&) = delete;
+    Mpg123Library& operator= (const Mpg123Library&) = delete;
+    /**
+     * Destructor. Waits until the thread has stopped.
+     */
+    ~Mpg123Library();
+    /**
+     * Get a factory for decoders that run in this program.
+     * @param ioService The io_service of the decoders.
+     * @return The factory.
+     */
+    static Factory factory (boost::asio::io_service& ioService);
+    void setListener (IListener& listener) override;
+    void load (const std::string& path) override;
+    void loadPaused (const std::string& path) override;
+    void pause() override;
+    void stop() override;
+    void jumpTo (int frameCount) override;
+    void jumpBy (int frames) override;
+    void requestSample() override;
+    void silence() override;
+    /**
+     * @see Decoder#restart
+     * The title is closed and the decoder reports again as if it had just
+     * been started. The commands that have not been executed yet are
+     * dropped.
+     */
+    void restart() override;
+    /**
+     * @see Decoder#kill
+     * Does nothing, since the decoder does not run as a child program.
+     */
+    void kill() override;
+    bool hasResponded() const override;
+    unsigned long getDroppedErrorByteCount() const override;
+    const PcmOutput* getOutput() const override;
+
+protected:
+    struct Command {
+        enum Type {
+            LOAD, LOAD_PAUSED, PAUSE, STOP, JUMP, JUMP_BY, SAMPLE, SILENCE,
+            RESTART
+        };
+        Type type;
+        std::string path;
+        int frames;
+    };
+    void queueCommand (Command::Type type,
+                       const std::string& path = std::string(),
+                       int frames = 0);
+    void run();
+    void execute (const Command& command, std::string& messages);
+    void decodeFrame (std::string& messages);
+    void open (const std::string& path, bool paused, std::string& messages);
+    void close();
+    bool startOutput (std::string& messages);
+    void appendVersion (std::string& messages) const;
+    void appendTags (const std::string& path, std::string& messages) const;
+    void appendStreamInfo (std::string& messages) const;
+    void appendFrameStatus (std::string& messages) const;
+    void appendError (std::string& messages) const;
+    void postMessages (const std::string& messages, unsigned int generation);
+    void handleMessages (const std::string& messages,
+                         unsigned int generation);
+
+private:
+    boost::asio::io_service& _ioService;
+    Mpg123Parser _parser;
+    mpg123_handle_struct* _handle;
+    out123_struct* _output;
+    /** The members below are guarded by the mutex. */
+    std::mutex _mutex;
+    std::condition_variable _commandQueued;
+    std::deque<Command> _commands;
+    bool _terminating;
+    /** Incremented by each restart, so the messages the thread has created
+     *  before are able to tell that they are obsolete. */
+    unsigned int _generation;
+    /** The members below are only used by the thread. */
+    bool _outputOpen;
+    bool _open;
+    bool _paused;
+    bool _silent;
+    std::thread _thread;
+};
+
+#endif	/* MPG123_LIBRARY_HPP */
+
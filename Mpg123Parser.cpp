@@ -0,0 +1,104 @@
+#include "Mpg123Parser.hpp"
+#include <cstdlib>
+#include <cstring>
+
+using std::size_t;
+using boost::asio::buffer;
+using boost::asio::mutable_buffers_1;
+
+//==============================================================================
+//------------------------------ Mpg123Parser ----------------------------------
+//==============================================================================
+const size_t Mpg123Parser::INITIAL_BUFFER_SIZE (4096);
+const size_t Mpg123Parser::MIN_FREE_SIZE (1024);
+
+Mpg123Parser::Mpg123Parser (IListener& listener)
+: _listener (&listener)
+, _buffer (INITIAL_BUFFER_SIZE)
+, _size (0) {
+}
+void Mpg123Parser::setListener (IListener& listener) {
+    _listener = &listener;
+}
+void Mpg123Parser::reset() {
+    _size = 0;
+}
+mutable_buffers_1 Mpg123Parser::prepare() {
+    if (_buffer.size() - _size < MIN_FREE_SIZE) {
+        _buffer.resize(_buffer.size() * 2);
+    }
+    return buffer(_buffer.data() + _size, _buffer.size() - _size);
+}
+void Mpg123Parser::commit (size_t length) {
+    char* begin = _buffer.data();
+    // Note: The partial line kept from the last read does not contain a line
+    // terminator, so only the new data has to be searched.
+    char* searchBegin = begin + _size;
+    char* end = searchBegin + length;
+    char* line = begin;
+    while (char* lineEnd = static_cast<char*>(memchr(searchBegin, '\n',
+                                                     end - searchBegin))) {
+        *lineEnd = '\0';
+        parseLine(line, lineEnd);
+        line = lineEnd + 1;
+        searchBegin = line;
+    }
+    _size = end - line;
+    if (_size > 0 && line != begin) {
+        memmove(begin, line, _size);
+    }
+}
+void Mpg123Parser::parseLine (char* line, char* end) {
+    // Note: Each message starts with '@', the tag byte and a blank. The only
+    // exception is the answer to SAMPLE.
+    if (end - line < 3 || line[0] != '@') {
+        return;
+    } else if (line[2] != ' ') {
+        if (strncmp(line, "@SAMPLE ", 8) == 0) {
+            char* next;
+            long sample = strtol(line + 8, &next, 10);
+            long sampleCount = strtol(next, &next, 10);
+            _listener->sampleReceived(sample, sampleCount);
+        }
+        return;
+    }
+    char* text = line + 3;
+    switch (line[1]) {
+        case 'F': {
+            char* next;
+            int framecount = strtol(text, &next, 10);
+            int framesLeft = strtol(next, &next, 10);
+            float seconds = strtof(next, &next);
+            float secondsLeft = strtof(next, &next);
+            _listener->frameReceived(framecount, framesLeft, seconds,
+                                    secondsLeft);
+            break;
+        }
+        case 'P': {
+            char* reason;
+            int statusCode = strtol(text, &reason, 10);
+            while (*reason == ' ') {
+                reason++;
+            }
+            _listener->playStatusReceived(statusCode,
+                    StringRef(reason, strcspn(reason, " ")));
+            break;
+        }
+        case 'I':
+            _listener->tagReceived(StringRef(text, end - text));
+            break;
+        case 'S':
+            _listener->streamInfoReceived(StringRef(text, end - text));
+            break;
+        case 'R': {
+            // Note: The version follows the name of the program.
+            const char* version = strchr(text, ' ');
+            version = (version == nullptr) ? end : version + 1;
+            _listener->versionReceived(StringRef(version, end - version));
+            break;
+        }
+        case 'E':
+            _listener->errorReceived(StringRef(text, end - text));
+            break;
+    }
+}
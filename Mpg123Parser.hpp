@@ -0,0 +1,121 @@
+#ifndef MPG123_PARSER_HPP
+#define	MPG123_PARSER_HPP
+
+#include <boost/asio/buffer.hpp>
+#include <boost/utility/string_ref.hpp>
+#include <cstddef>
+#include <vector>
+
+/**
+ * Incremental parser for the messages mpg123 writes in remote control mode
+ * (-R). The output of mpg123 is read directly into the buffer of the parser
+ * (see prepare and commit). Every complete line is parsed in place and
+ * dispatched on its tag byte (e.g. F for "@F ..."); the texts handed over to
+ * the listener refer to the buffer and are only valid during the call. A
+ * partial line at the end of the buffer is kept until the rest of it has been
+ * read.
+ */
+class Mpg123Parser {
+public:
+    typedef boost::string_ref StringRef;
+    /**
+     * Interface that has to be implemented by the receiver of the parsed
+     * messages. The texts refer to the buffer of the parser and have to be
+     * copied if they are needed after the call.
+     */
+    class IListener {
+    public:
+        /**
+         * Virtual destructor.
+         */
+        virtual ~IListener() {}
+        /**
+         * Called for "@R MPG123 <version>".
+         * @param version The version of mpg123.
+         */
+        virtual void versionReceived (const StringRef& version) = 0;
+        /**
+         * Called for "@I <text>", i.e. the ID3 tags or the file name of the
+         * loaded title.
+         * @param tag The text after the tag byte.
+         */
+        virtual void tagReceived (const StringRef& tag) = 0;
+        /**
+         * Called for "@S <stream information>" after a title has been loaded.
+         * @param streamInfo The text after the tag byte.
+         */
+        virtual void streamInfoReceived (const StringRef& streamInfo) = 0;
+        /**
+         * Called for "@F <frame> <frames left> <seconds> <seconds left>".
+         */
+        virtual void frameReceived (int framecount, int framesLeft,
+                                    float seconds, float secondsLeft) = 0;
+        /**
+         * Called for "@SAMPLE <sample> <samples>", the answer to the SAMPLE
+         * command.
+         * @param sample The number of the sample currently played.
+         * @param sampleCount The number of samples of the title.
+         */
+        virtual void sampleReceived (long sample, long sampleCount) = 0;
+        /**
+         * Called for "@P <status> [<reason>]".
+         * @param statusCode 0 if playing stopped, 1 if paused, 2 if unpaused.
+         * @param reason The reason of the status, e.g. EOF. Empty if not
+         *               given.
+         */
+        virtual void playStatusReceived (int statusCode,
+                                         const StringRef& reason) = 0;
+        /**
+         * Called for "@E <message>".
+         * @param message The error message.
+         */
+        virtual void errorReceived (const StringRef& message) = 0;
+    };
+    /**
+     * Constructor.
+     * @param listener The receiver of the parsed messages.
+     */
+    Mpg123Parser (IListener& listener);
+    Mpg123Parser (const Mpg123Parser&) = delete;
+    Mpg123Parser& operator= (const Mpg123Parser&) = delete;
+    /**
+     * Set the receiver of the messages parsed from now on.
+     * @param listener The new receiver of the parsed messages.
+     */
+    void setListener (IListener& listener);
+    /**
+     * Get the free part of the buffer the next output of mpg123 has to be
+     * read into. The buffer grows if a line does not fit into it.
+     * @return The free part of the buffer.
+     */
+    boost::asio::mutable_buffers_1 prepare();
+    /**
+     * Parse the complete lines of the data that has been read into the free
+     * part of the buffer and call the listener for each message.
+     * @param length The number of bytes that have been read.
+     */
+    void commit (std::size_t length);
+    /**
+     * Drop the partial line kept from the last read, e.g. because the output
+     * is read from a new mpg123.
+     */
+    void reset();
+
+protected:
+    /**
+     * Parse a single line and call the listener.
+     * @param line The begin of the line.
+     * @param end The end of the line. The line terminator has been replaced
+     *            by a null character.
+     */
+    void parseLine (char* line, char* end);
+
+private:
+    IListener* _listener;
+    std::vector<char> _buffer;
+    std::size_t _size;
+    static const std::size_t INITIAL_BUFFER_SIZE;
+    static const std::size_t MIN_FREE_SIZE;
+};
+
+#endif	/* MPG123_PARSER_HPP */
@@ -0,0 +1,361 @@
+#include "Mpg123Process.hpp"
+#include <fcntl.h>
+#include <iostream>
+#include <vector>
+#include <boost/asio.hpp>
+#include <boost/bind.hpp>
+
+using std::string;
+using std::vector;
+using std::to_string;
+using std::unique_ptr;
+using std::size_t;
+using std::cerr;
+using std::endl;
+using boost::bind;
+using boost::asio::io_service;
+using boost::asio::async_write;
+using boost::asio::buffer;
+using boost::asio::buffer_size;
+using boost::asio::mutable_buffers_1;
+using boost::asio::placeholders::error;
+using boost::asio::placeholders::bytes_transferred;
+using boost::system::error_code;
+using boost::posix_time::milliseconds;
+
+namespace {
+    const vector<string> ARGUMENTS {"-m", "-R"};
+    // Note: The messages are written to the error output, since the output
+    // carries the audio.
+    const vector<string> RAW_ARGUMENTS {"-m", "-R", "--remote-err", "-s",
+            "-r", to_string(PcmSink::SAMPLE_RATE), "-e", "s16"};
+    // Note: The audio of the former position that is still in the pipe is
+    // heard after a jump, so the pipe is kept small. The ring of the
+    // PcmOutput does the buffering instead.
+    const int AUDIO_PIPE_SIZE = 8192;
+    const std::chrono::milliseconds OUTPUT_BUFFER_TIME (500);
+    const milliseconds OUTPUT_RETRY_INTERVAL (10);
+}
+
+//==============================================================================
+//------------------------------ Mpg123Process ---------------------------------
+//==============================================================================
+Mpg123Process::Mpg123Process (const string& executable,
+                              io_service& ioService, IListener& listener,
+                              unique_ptr<PcmOutput> output)
+: _ioService (ioService)
+, _executable (executable)
+, _program (new ChildProgram (executable,
+                              output ? RAW_ARGUMENTS : ARGUMENTS, ioService))
+, _in (_program->in())
+, _out (_program->out())
+, _err (_program->err())
+, _listener (&listener)
+, _output (std::move(output))
+, _outputTimer (ioService)
+, _outputListener (*this)
+, _titleEnded (true)
+, _parser (_output ? static_cast<Mpg123Parser::IListener&>(_outputListener)
+                   : listener)
+, _errorLog ("mpg123: ")
+, _writeScheduled (false)
+, _responded (false)
+, _generation (0) {
+    startProgram();
+}
+Decoder::Factory Mpg123Process::factory (const string& executable,
+                                         io_service& ioService,
+                                         const PcmSink::Factory& createSink) {
+    return [executable, &ioService, createSink](IListener& listener) {
+        unique_ptr<PcmOutput> output;
+        if (createSink) {
+            output.reset(new PcmOutput (createSink(), OUTPUT_BUFFER_TIME));
+        }
+        return unique_ptr<Decoder> (new Mpg123Process (executable, ioService,
+                listener, std::move(output)));
+    };
+}
+void Mpg123Process::setListener (IListener& listener) {
+    _listener = &listener;
+    // Note: The output listener forwards to the listener set here.
+    if (!_output) {
+        _parser.setListener(listener);
+    }
+}
+void Mpg123Process::load (const string& path) {
+    queueCommand("LOAD ", path);
+    if (_output) {
+        dropOutput();
+        _titleEnded = false;
+        _output->start();
+    }
+}
+void Mpg123Process::loadPaused (const string& path) {
+    queueCommand("LOADPAUSED ", path);
+    if (_output) {
+        dropOutput();
+        _titleEnded = false;
+        _output->start();
+    }
+}
+void Mpg123Process::pause() {
+    queueCommand("PAUSE");
+}
+void Mpg123Process::stop() {
+    queueCommand("STOP");
+    if (_output) {
+        dropOutput();
+    }
+}
+void Mpg123Process::jumpTo (int frameCount) {
+    queueCommand("JUMP ", to_string(frameCount));
+    if (_output) {
+        _output->drop();
+    }
+}
+void Mpg123Process::jumpBy (int frames) {
+    if (_output) {
+        _output->drop();
+    }
+    if (frames < 0) {
+        queueCommand("JUMP -", to_string(-frames));
+    } else {
+        queueCommand("JUMP +", to_string(frames));
+    }
+}
+void Mpg123Process::requestSample() {
+    queueCommand("SAMPLE");
+}
+void Mpg123Process::silence() {
+    queueCommand("SILENCE");
+}
+void Mpg123Process::queueCommand (const char* command,
+                                  const string& argument) {
+    _queuedCommands += command;
+    _queuedCommands += argument;
+    _queuedCommands += '\n';
+    if (!_writeScheduled) {
+        // Note: The write is started by a handler, so that all commands
+        // queued by the current handler (e.g. LOAD followed by JUMP) are
+        // written at once.
+        _writeScheduled = true;
+        _ioService.post(bind(&Mpg123Process::writeCommands, this,
+                             _generation));
+    }
+}
+void Mpg123Process::restart() {
+    stopProgram();
+    // Note: The operations on the descriptors of the former mpg123 have been
+    // cancelled, their handlers are ignored due to the new generation.
+    _generation++;
+    _queuedCommands.clear();
+    _writtenCommands.clear();
+    _writeScheduled = false;
+    _responded = false;
+    _parser.reset();
+    _errorLog.clear();
+    if (_output) {
+        _outputTimer.cancel();
+        _output->drop();
+        _output->finish();
+        _titleEnded = true;
+    }
+    _program.reset(new ChildProgram (_executable,
+            _output ? RAW_ARGUMENTS : ARGUMENTS, _ioService));
+    _in = _program->in();
+    _out = _program->out();
+    _err = _program->err();
+    startProgram();
+}
+void Mpg123Process::kill() {
+    _program->kill();
+}
+bool Mpg123Process::hasResponded() const {
+    return _responded;
+}
+unsigned long Mpg123Process::getDroppedErrorByteCount() const {
+    return _errorLog.getDroppedByteCount();
+}
+const PcmOutput* Mpg123Process::getOutput() const {
+    return _output.get();
+}
+void Mpg123Process::startProgram() {
+    bindHandleExitMethod();
+    bindHandleInputMethod();
+    if (_output) {
+        fcntl(_out.native_handle(), F_SETPIPE_SZ, AUDIO_PIPE_SIZE);
+        bindHandleAudioMethod();
+    } else {
+        bindHandleErrorMethod();
+    }
+}
+void Mpg123Process::stopProgram() {
+    error_code ignored;
+    _in.close(ignored);
+    _out.close(ignored);
+    _err.close(ignored);
+    // Note: mpg123 may hang, so it is not asked to quit. It is reaped by the
+    // handler waiting for its exit, which is ignored due to the new
+    // generation.
+    _program->kill();
+}
+void Mpg123Process::dropOutput() {
+    if (!_titleEnded) {
+        _output->drop();
+    }
+}
+void Mpg123Process::bindHandleExitMethod() {
+    _program->asyncWaitForExit(bind(&Mpg123Process::handleExit, this, _1,
+                                    _generation));
+}
+void Mpg123Process::handleExit (int waitpidStatus, unsigned int generation) {
+    if (generation != _generation) {
+        return;
+    }
+    // Note: The listener may restart mpg123 right away.
+    _listener->terminated(waitpidStatus);
+}
+void Mpg123Process::writeCommands (unsigned int generation) {
+    if (generation != _generation) {
+        return;
+    }
+    // Note: Both buffers keep their capacity, so no memory is allocated once
+    // they have grown to the size of the longest command sequence.
+    _writtenCommands.swap(_queuedCommands);
+    async_write(_in, buffer(_writtenCommands),
+            bind(&Mpg123Process::handleWriteCommands, this, error,
+                 _generation));
+}
+void Mpg123Process::handleWriteCommands (const error_code& error,
+                                         unsigned int generation) {
+    if (generation != _generation) {
+        return;
+    }
+    _writtenCommands.clear();
+    if (error) {
+        cerr << "Unable to write commands to mpg123: " << error.message()
+             << endl;
+        _queuedCommands.clear();
+    }
+    if (_queuedCommands.empty()) {
+        _writeScheduled = false;
+    } else {
+        writeCommands(_generation);
+    }
+}
+void Mpg123Process::bindHandleInputMethod() {
+    ChildProgram::StreamDescriptor& messages = _output ? _err : _out;
+    messages.async_read_some(_parser.prepare(),
+            bind(&Mpg123Process::handleReadInput, this, error,
+            bytes_transferred, _generation));
+}
+void Mpg123Process::handleReadInput (const error_code& error, size_t length,
+                                     unsigned int generation) {
+    if (generation != _generation) {
+        return;
+    }
+    if (!error) {
+        _responded = true;
+        // Note: The parser calls the listener for each complete line.
+        _parser.commit(length);
+        bindHandleInputMethod();
+    } else if (error != boost::asio::error::misc_errors::eof) {
+        _listener->communicationProblem(error);
+    }
+    // Note: If mpg123 has closed its output, the handler waiting for its
+    // exit informs the listener.
+}
+void Mpg123Process::bindHandleErrorMethod() {
+    _err.async_read_some(_errorLog.prepare(),
+            bind(&Mpg123Process::handleReadError, this, error,
+            bytes_transferred, _generation));
+}
+void Mpg123Process::handleReadError (const error_code& error, size_t length,
+                                     unsigned int generation) {
+    if (generation != _generation) {
+        return;
+    }
+    // Note: The end of mpg123 is noticed by reading its output.
+    if (!error) {
+        _errorLog.commit(length);
+        bindHandleErrorMethod();
+    }
+}
+void Mpg123Process::bindHandleAudioMethod() {
+    mutable_buffers_1 free = _output->prepare();
+    if (buffer_size(free) == 0) {
+        // Note: mpg123 blocks on the full pipe meanwhile, so it decodes no
+        // further ahead than the ring holds.
+        _outputTimer.expires_from_now(OUTPUT_RETRY_INTERVAL);
+        _outputTimer.async_wait(bind(&Mpg123Process::handleOutputTimer, this,
+                                     error, _generation));
+        return;
+    }
+    _out.async_read_some(free, bind(&Mpg123Process::handleReadAudio, this,
+                                    error, bytes_transferred, _generation));
+}
+void Mpg123Process::handleReadAudio (const error_code& error, size_t length,
+                                     unsigned int generation) {
+    if (generation != _generation) {
+        return;
+    }
+    // Note: The end of mpg123 is noticed by reading its messages.
+    if (!error) {
+        _output->commit(length);
+        bindHandleAudioMethod();
+    }
+}
+void Mpg123Process::handleOutputTimer (const error_code& error,
+                                       unsigned int generation) {
+    if (!error && generation == _generation) {
+        bindHandleAudioMethod();
+    }
+}
+
+//==============================================================================
+//---------------------- Mpg123Process::OutputListener -------------------------
+//==============================================================================
+Mpg123Process::OutputListener::OutputListener (Mpg123Process& process)
+: _process (process) {
+}
+void Mpg123Process::OutputListener::versionReceived (
+        const StringRef& version) {
+    _process._listener->versionReceived(version);
+}
+void Mpg123Process::OutputListener::tagReceived (const StringRef& tag) {
+    _process._listener->tagReceived(tag);
+}
+void Mpg123Process::OutputListener::streamInfoReceived (
+        const StringRef& streamInfo) {
+    _process._listener->streamInfoReceived(streamInfo);
+}
+void Mpg123Process::OutputListener::frameReceived (int framecount,
+        int framesLeft, float seconds, float secondsLeft) {
+    _process._listener->frameReceived(framecount, framesLeft, seconds,
+                                      secondsLeft);
+}
+void Mpg123Process::OutputListener::sampleReceived (long sample,
+                                                    long sampleCount) {
+    _process._listener->sampleReceived(sample, sampleCount);
+}
+void Mpg123Process::OutputListener::playStatusReceived (int statusCode,
+        const StringRef& reason) {
+    switch (statusCode) {
+        case 0:
+            // Note: The end of the title is still in the ring, it is played
+            // even if the next title is loaded.
+            _process._titleEnded = true;
+            _process._output->finish();
+            break;
+        case 1:
+            _process._output->setPaused(true);
+            break;
+        case 2:
+            _process._output->setPaused(false);
+            break;
+    }
+    _process._listener->playStatusReceived(statusCode, reason);
+}
+void Mpg123Process::OutputListener::errorReceived (const StringRef& message) {
+    _process._listener->errorReceived(message);
+}
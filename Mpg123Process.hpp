@@ -0,0 +1,170 @@
+#ifndef MPG123_PROCESS_HPP
+#define	MPG123_PROCESS_HPP
+
+#include "ChildProgram.hpp"
+#include "Decoder.hpp"
+#include "LogRing.hpp"
+#include "Mpg123Parser.hpp"
+#include "PcmOutput.hpp"
+#include <boost/asio/deadline_timer.hpp>
+#include <memory>
+#include <string>
+
+namespace boost {
+    namespace asio {
+        class io_service;
+    }
+    namespace system {
+        class error_code;
+    }
+}
+
+/**
+ * A running mpg123 in remote control mode (-R). The commands are written
+ * asynchronously from a queue, the messages of mpg123 are parsed as they
+ * arrive and handed over to the listener. The error output of mpg123 is
+ * drained into a LogRing, so mpg123 never blocks on it.
+ *
+ * If a PcmOutput is given, mpg123 writes the raw audio to its output (-s)
+ * and its messages to its error output instead. The audio is read into the
+ * PcmOutput, which plays it.
+ */
+class Mpg123Process : public Decoder {
+public:
+    /**
+     * Constructor. Starts mpg123 in remote control mode.
+     * @param executable The path of the mpg123 executable.
+     * @param ioService The io_service the commands are written and the
+     *                  messages are read in.
+     * @param listener The receiver of the messages.
+     * @param output The output the audio is played by, or nullptr if mpg123
+     *               plays the audio itself.
+     * @exception ChildProgram::CreationException Thrown if mpg123 could not
+     *            be started.
+     */
+    Mpg123Process (const std::string& executable,
+                   boost::asio::io_service& ioService, IListener& listener,
+                   std::unique_ptr<PcmOutput> output = nullptr);
+    Mpg123Process (const Mpg123Process&) = delete;
+    Mpg123Process& operator= (const Mpg123Process&) = delete;
+    /**
+     * Get a factory for decoders that run the given mpg123 executable.
+     * @param executable The path of the mpg123 executable.
+     * @param ioService The io_service of the decoders.
+     * @param createSink Creates the sink of the PcmOutput of each decoder.
+     *                   If empty, mpg123 plays the audio itself.
+     * @return The factory.
+     */
+    static Factory factory (const std::string& executable,
+                            boost::asio::io_service& ioService,
+                            const PcmSink::Factory& createSink =
+                                    PcmSink::Factory());
+    /**
+     * @see Decoder#setListener
+     * Note that the messages that have already been read but not yet parsed
+     * are handed over to the new listener as well.
+     */
+    void setListener (IListener& listener) override;
+    void load (const std::string& path) override;
+    void loadPaused (const std::string& path) override;
+    void pause() override;
+    void stop() override;
+    void jumpTo (int frameCount) override;
+    void jumpBy (int frames) override;
+    void requestSample() override;
+    void silence() override;
+    /**
+     * @see Decoder#restart
+     * A running mpg123 is killed. The commands that have not been written
+     * yet are dropped.
+     */
+    void restart() override;
+    /**
+     * @see Decoder#kill
+     * The listener is informed as soon as mpg123 has been reaped.
+     */
+    void kill() override;
+    bool hasResponded() const override;
+    unsigned long getDroppedErrorByteCount() const override;
+    const PcmOutput* getOutput() const override;
+
+protected:
+    /**
+     * Forwards the messages to the listener and controls the PcmOutput by
+     * the play status of mpg123.
+     */
+    class OutputListener : public Mpg123Parser::IListener {
+    public:
+        typedef Mpg123Parser::StringRef StringRef;
+        OutputListener (Mpg123Process& process);
+        void versionReceived (const StringRef& version) override;
+        void tagReceived (const StringRef& tag) override;
+        void streamInfoReceived (const StringRef& streamInfo) override;
+        void frameReceived (int framecount, int framesLeft,
+                            float seconds, float secondsLeft) override;
+        void sampleReceived (long sample, long sampleCount) override;
+        void playStatusReceived (int statusCode,
+                                 const StringRef& reason) override;
+        void errorReceived (const StringRef& message) override;
+    private:
+        Mpg123Process& _process;
+    };
+    /**
+     * Append a command to the queue of commands to be written. The write is
+     * started from a handler, so all commands queued by the current handler
+     * are written at once.
+     * @param command The command including a trailing blank if an argument
+     *                follows.
+     * @param argument The argument of the command, if any.
+     */
+    void queueCommand (const char* command,
+                       const std::string& argument = std::string());
+    void startProgram();
+    void stopProgram();
+    /**
+     * Discard the audio of the current title, unless the title has ended
+     * and its end is still to be heard.
+     */
+    void dropOutput();
+    void bindHandleExitMethod();
+    void handleExit (int waitpidStatus, unsigned int generation);
+    void writeCommands (unsigned int generation);
+    void handleWriteCommands (const boost::system::error_code& error,
+                              unsigned int generation);
+    void bindHandleInputMethod();
+    void handleReadInput (const boost::system::error_code& error,
+                          std::size_t length, unsigned int generation);
+    void bindHandleErrorMethod();
+    void handleReadError (const boost::system::error_code& error,
+                          std::size_t length, unsigned int generation);
+    void bindHandleAudioMethod();
+    void handleReadAudio (const boost::system::error_code& error,
+                          std::size_t length, unsigned int generation);
+    void handleOutputTimer (const boost::system::error_code& error,
+                            unsigned int generation);
+
+private:
+    boost::asio::io_service& _ioService;
+    const std::string _executable;
+    std::unique_ptr<ChildProgram> _program;
+    ChildProgram::StreamDescriptor _in;
+    ChildProgram::StreamDescriptor _out;
+    ChildProgram::StreamDescriptor _err;
+    IListener* _listener;
+    std::unique_ptr<PcmOutput> _output;
+    boost::asio::deadline_timer _outputTimer;
+    OutputListener _outputListener;
+    /** True if no title is loaded or mpg123 has decoded its end. */
+    bool _titleEnded;
+    Mpg123Parser _parser;
+    LogRing _errorLog;
+    std::string _queuedCommands;
+    std::string _writtenCommands;
+    bool _writeScheduled;
+    bool _responded;
+    /** Incremented by each restart, so the handlers of the operations of a
+     *  former mpg123 are able to tell that they are obsolete. */
+    unsigned int _generation;
+};
+
+#endif	/* MPG123_PROCESS_HPP */
@@ -0,0 +1,38 @@
+#include "NullSink.hpp"
+#include <algorithm>
+#include <thread>
+
+using std::size_t;
+using std::chrono::milliseconds;
+using std::chrono::microseconds;
+using std::chrono::steady_clock;
+using std::chrono::duration_cast;
+
+//==============================================================================
+//-------------------------------- NullSink ------------------------------------
+//==============================================================================
+const milliseconds NullSink::BUFFER_TIME (50);
+
+NullSink::NullSink()
+: _playedTime (steady_clock::now()) {
+}
+bool NullSink::open() {
+    _playedTime = steady_clock::now();
+    return true;
+}
+void NullSink::close() {
+    std::this_thread::sleep_until(_playedTime);
+}
+void NullSink::drop() {
+    _playedTime = steady_clock::now();
+}
+void NullSink::write (const char* data, size_t size) {
+    // Note: After an underrun the audio is played right away.
+    _playedTime = std::max(_playedTime, steady_clock::now()) +
+                  getDuration(size);
+    std::this_thread::sleep_until(_playedTime - BUFFER_TIME);
+}
+microseconds NullSink::getDelay() const {
+    return std::max(duration_cast<microseconds>(
+            _playedTime - steady_clock::now()), microseconds(0));
+}
@@ -0,0 +1,28 @@
+#ifndef NULL_SINK_HPP
+#define	NULL_SINK_HPP
+
+#include "PcmSink.hpp"
+#include <chrono>
+
+/**
+ * Sink that discards the audio, but takes as long as a device to play it.
+ * Useful to run the player without a sound card, e.g. for measurements.
+ */
+class NullSink : public PcmSink {
+public:
+    NullSink();
+    bool open() override;
+    void close() override;
+    void drop() override;
+    void write (const char* data, std::size_t size) override;
+    std::chrono::microseconds getDelay() const override;
+
+private:
+    /** The time of audio the simulated device buffers. */
+    static const std::chrono::milliseconds BUFFER_TIME;
+    /** The time the audio written last has been played. */
+    std::chrono::steady_clock::time_point _playedTime;
+};
+
+#endif	/* NULL_SINK_HPP */
+
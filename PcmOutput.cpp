@@ -0,0 +1,138 @@
+#include "PcmOutput.hpp"
+#include <pthread.h>
+#include <sched.h>
+#include <algorithm>
+#include <vector>
+
+using std::size_t;
+using std::min;
+using std::vector;
+using std::unique_ptr;
+using std::chrono::milliseconds;
+using std::chrono::microseconds;
+using boost::asio::mutable_buffers_1;
+
+//==============================================================================
+//-------------------------------- PcmOutput -----------------------------------
+//==============================================================================
+const size_t PcmOutput::PERIOD_SIZE (1024 * PcmSink::FRAME_SIZE);
+const milliseconds PcmOutput::POLL_INTERVAL (5);
+const int PcmOutput::PRIORITY (10);
+
+PcmOutput::PcmOutput (unique_ptr<PcmSink> sink, milliseconds bufferTime)
+: _sink (std::move(sink))
+, _ring (bufferTime.count() * PcmSink::SAMPLE_RATE / 1000 *
+         PcmSink::FRAME_SIZE)
+, _terminating (false)
+, _paused (false)
+, _finished (true)
+, _dropRequested (false)
+, _dropPosition (0)
+, _underrunCount (0)
+, _sinkDelay (0)
+, _sinkOpen (false)
+, _thread (&PcmOutput::run, this) {
+    raisePriority();
+}
+PcmOutput::~PcmOutput() {
+    _terminating = true;
+    _thread.join();
+    if (_sinkOpen) {
+        _sink->drop();
+        closeSink();
+    }
+}
+mutable_buffers_1 PcmOutput::prepare() {
+    return _ring.prepare();
+}
+void PcmOutput::commit (size_t length) {
+    _ring.commit(length);
+}
+void PcmOutput::start() {
+    _paused = false;
+    _finished = false;
+}
+void PcmOutput::finish() {
+    _finished = true;
+}
+void PcmOutput::setPaused (bool paused) {
+    _paused = paused;
+}
+void PcmOutput::drop() {
+    // Note: Only the audio committed so far is dropped, the thread may see
+    // the request after more audio has been committed.
+    _dropPosition = _ring.getWritePosition();
+    _dropRequested = true;
+}
+unsigned long PcmOutput::getUnderrunCount() const {
+    return _underrunCount;
+}
+microseconds PcmOutput::getBufferedTime() const {
+    return PcmSink::getDuration(_ring.getFillLevel());
+}
+microseconds PcmOutput::getLatency() const {
+    return getBufferedTime() + microseconds(_sinkDelay);
+}
+void PcmOutput::run() {
+    vector<char> period (PERIOD_SIZE);
+    // Note: Running out of audio is an underrun only if audio has been
+    // played right before, not after pausing or dropping the audio.
+    bool playing = false;
+    while (!_terminating) {
+        if (_dropRequested.exchange(false)) {
+            _ring.skipTo(_dropPosition);
+            if (_sinkOpen) {
+                _sink->drop();
+            }
+            playing = false;
+        }
+        if (_paused) {
+            // Note: The sink is closed, so another output (e.g. the one of
+            // a prompt) is able to open the device meanwhile.
+            closeSink();
+            playing = false;
+            std::this_thread::sleep_for(POLL_INTERVAL);
+            continue;
+        }
+        size_t length = _ring.getFillLevel();
+        length -= length % PcmSink::FRAME_SIZE;
+        if (length == 0) {
+            if (_finished) {
+                closeSink();
+            } else if (playing) {
+                _underrunCount++;
+            }
+            playing = false;
+            std::this_thread::sleep_for(POLL_INTERVAL);
+            continue;
+        }
+        if (!_sinkOpen) {
+            if (!_sink->open()) {
+                // Note: The device may still be used by the output of the
+                // former title, which is closed as soon as it has played
+                // the end of the title.
+                std::this_thread::sleep_for(POLL_INTERVAL);
+                continue;
+            }
+            _sinkOpen = true;
+        }
+        length = _ring.read(period.data(), min(length, PERIOD_SIZE));
+        _sink->write(period.data(), length);
+        _sinkDelay = _sink->getDelay().count();
+        playing = true;
+    }
+}
+void PcmOutput::raisePriority() {
+    sched_param parameter;
+    parameter.sched_priority = PRIORITY;
+    // Note: Without the permission to do so, the thread keeps the normal
+    // priority and relies on the ring to cover for the delays.
+    pthread_setschedparam(_thread.native_handle(), SCHED_FIFO, &parameter);
+}
+void PcmOutput::closeSink() {
+    if (_sinkOpen) {
+        _sink->close();
+        _sinkOpen = false;
+        _sinkDelay = 0;
+    }
+}
@@ -0,0 +1,109 @@
+#ifndef PCM_OUTPUT_HPP
+#define	PCM_OUTPUT_HPP
+
+#include "PcmRing.hpp"
+#include "PcmSink.hpp"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+/**
+ * Plays the raw audio of a decoder on a PcmSink. The audio is handed over by
+ * a lock-free PcmRing to a thread of its own, which runs with real-time
+ * priority if allowed. The ring buffers enough audio to keep playing while
+ * the decoder is held up, e.g. by a slow SD card.
+ *
+ * The producer side (prepare, commit and the control methods) has to be
+ * used by a single thread, the io_service of the decoder. The metrics may
+ * be read by any thread.
+ */
+class PcmOutput {
+public:
+    /**
+     * Constructor. Starts the thread, the sink is opened as soon as there
+     * is audio to be played.
+     * @param sink The device the audio is played on.
+     * @param bufferTime The time of audio the ring holds.
+     */
+    PcmOutput (std::unique_ptr<PcmSink> sink,
+               std::chrono::milliseconds bufferTime);
+    PcmOutput (const PcmOutput&) = delete;
+    PcmOutput& operator= (const PcmOutput&) = delete;
+    /**
+     * Destructor. Waits until the thread has stopped, the audio that has
+     * not been played yet is discarded.
+     */
+    ~PcmOutput();
+    /**
+     * @see PcmRing#prepare
+     */
+    boost::asio::mutable_buffers_1 prepare();
+    /**
+     * @see PcmRing#commit
+     */
+    void commit (std::size_t length);
+    /**
+     * Start a new title. The audio that follows is played even if the
+     * former title has been finished.
+     */
+    void start();
+    /**
+     * Tell that no more audio follows, e.g. because the title has ended.
+     * The sink is closed as soon as the buffered audio has been played and
+     * running out of audio is not counted as underrun.
+     */
+    void finish();
+    /**
+     * Pause or continue playing. The sink is closed while the output is
+     * paused, the buffered audio is kept.
+     * @param paused True to pause playing.
+     */
+    void setPaused (bool paused);
+    /**
+     * Discard the audio that has been committed so far, e.g. because the
+     * decoder jumps to another position.
+     */
+    void drop();
+    /**
+     * Get the number of times the ring ran out of audio while playing.
+     * @return The number of underruns.
+     */
+    unsigned long getUnderrunCount() const;
+    /**
+     * Get the time of audio in the ring.
+     * @return The time of buffered audio.
+     */
+    std::chrono::microseconds getBufferedTime() const;
+    /**
+     * Get the time until audio that is committed now is heard, i.e. the
+     * buffered audio plus the delay of the sink.
+     * @return The latency of the output.
+     */
+    std::chrono::microseconds getLatency() const;
+
+protected:
+    void run();
+    void raisePriority();
+    void closeSink();
+
+private:
+    static const std::size_t PERIOD_SIZE;
+    static const std::chrono::milliseconds POLL_INTERVAL;
+    static const int PRIORITY;
+    std::unique_ptr<PcmSink> _sink;
+    PcmRing _ring;
+    std::atomic<bool> _terminating;
+    std::atomic<bool> _paused;
+    std::atomic<bool> _finished;
+    std::atomic<bool> _dropRequested;
+    std::atomic<std::size_t> _dropPosition;
+    std::atomic<unsigned long> _underrunCount;
+    std::atomic<long> _sinkDelay;
+    /** Only used by the thread. */
+    bool _sinkOpen;
+    std::thread _thread;
+};
+
+#endif	/* PCM_OUTPUT_HPP */
+
@@ -0,0 +1,75 @@
+#include "PcmRing.hpp"
+#include <algorithm>
+#include <cstring>
+
+using std::size_t;
+using std::min;
+using std::memory_order_relaxed;
+using std::memory_order_acquire;
+using std::memory_order_release;
+using boost::asio::buffer;
+using boost::asio::mutable_buffers_1;
+
+namespace {
+    size_t roundUpToPowerOfTwo (size_t size) {
+        size_t powerOfTwo = 1;
+        while (powerOfTwo < size) {
+            powerOfTwo *= 2;
+        }
+        return powerOfTwo;
+    }
+}
+
+//==============================================================================
+//--------------------------------- PcmRing ------------------------------------
+//==============================================================================
+PcmRing::PcmRing (size_t capacity)
+: _ring (roundUpToPowerOfTwo(capacity))
+, _mask (_ring.size() - 1)
+, _readPosition (0)
+, _writePosition (0) {
+}
+mutable_buffers_1 PcmRing::prepare() {
+    // Note: The producer owns the write position, the read position is
+    // acquired since the consumer must have copied the audio out of the
+    // part that is overwritten.
+    size_t writePosition = _writePosition.load(memory_order_relaxed);
+    size_t free = _ring.size() -
+            (writePosition - _readPosition.load(memory_order_acquire));
+    size_t offset = writePosition & _mask;
+    return buffer(_ring.data() + offset, min(free, _ring.size() - offset));
+}
+void PcmRing::commit (size_t length) {
+    _writePosition.store(_writePosition.load(memory_order_relaxed) + length,
+                         memory_order_release);
+}
+size_t PcmRing::read (char* data, size_t length) {
+    size_t readPosition = _readPosition.load(memory_order_relaxed);
+    length = min(length,
+            _writePosition.load(memory_order_acquire) - readPosition);
+    size_t offset = readPosition & _mask;
+    size_t first = min(length, _ring.size() - offset);
+    memcpy(data, _ring.data() + offset, first);
+    memcpy(data + first, _ring.data(), length - first);
+    _readPosition.store(readPosition + length, memory_order_release);
+    return length;
+}
+void PcmRing::skipTo (size_t position) {
+    size_t readPosition = _readPosition.load(memory_order_relaxed);
+    size_t fillLevel = _writePosition.load(memory_order_acquire) -
+                       readPosition;
+    // Note: A position that has already been read lies "behind" the read
+    // position, which makes the distance larger than the fill level.
+    if (position - readPosition <= fillLevel) {
+        _readPosition.store(position, memory_order_release);
+    }
+}
+size_t PcmRing::getFillLevel() const {
+    // Note: The read position is loaded first, so the fill level is never
+    // negative, even if both positions change in the meantime.
+    size_t readPosition = _readPosition.load(memory_order_acquire);
+    return _writePosition.load(memory_order_acquire) - readPosition;
+}
+size_t PcmRing::getWritePosition() const {
+    return _writePosition.load(memory_order_relaxed);
+}
@@ -0,0 +1,72 @@
+#ifndef PCM_RING_HPP
+#define	PCM_RING_HPP
+
+#include <boost/asio/buffer.hpp>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/**
+ * Lock-free ring buffer for decoded audio with a single producer and a
+ * single consumer. The producer reads the audio directly into the ring (see
+ * prepare and commit), the consumer copies it out (see read). The positions
+ * count the bytes written and read since the ring has been created, they
+ * wrap around without harm since the capacity is a power of two.
+ */
+class PcmRing {
+public:
+    /**
+     * Constructor.
+     * @param capacity The minimum number of bytes the ring holds. It is
+     *                 rounded up to the next power of two.
+     */
+    explicit PcmRing (std::size_t capacity);
+    PcmRing (const PcmRing&) = delete;
+    PcmRing& operator= (const PcmRing&) = delete;
+    /**
+     * Get the free part of the ring up to its end, the next audio has to be
+     * read into. Called by the producer only.
+     * @return The free part of the ring, empty if the ring is full.
+     */
+    boost::asio::mutable_buffers_1 prepare();
+    /**
+     * Hand the audio that has been read into the free part of the ring over
+     * to the consumer. Called by the producer only.
+     * @param length The number of bytes that have been read.
+     */
+    void commit (std::size_t length);
+    /**
+     * Copy audio out of the ring. Called by the consumer only.
+     * @param data The buffer the audio is copied to.
+     * @param length The maximum number of bytes to be copied.
+     * @return The number of bytes copied.
+     */
+    std::size_t read (char* data, std::size_t length);
+    /**
+     * Discard the audio up to the given position, e.g. the position the
+     * producer had reached when it requested to drop the audio. Called by
+     * the consumer only.
+     * @param position A write position returned by getWritePosition.
+     */
+    void skipTo (std::size_t position);
+    /**
+     * Get the number of bytes in the ring. Called by any thread.
+     * @return The number of bytes that have been written but not yet read.
+     */
+    std::size_t getFillLevel() const;
+    /**
+     * Get the position the next audio is written to. Called by the producer
+     * only.
+     * @return The write position.
+     */
+    std::size_t getWritePosition() const;
+
+private:
+    std::vector<char> _ring;
+    const std::size_t _mask;
+    std::atomic<std::size_t> _readPosition;
+    std::atomic<std::size_t> _writePosition;
+};
+
+#endif	/* PCM_RING_HPP */
+
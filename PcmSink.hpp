@@ -0,0 +1,62 @@
+#ifndef PCM_SINK_HPP
+#define	PCM_SINK_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+/**
+ * Interface of the devices a PcmOutput plays the decoded audio on. The audio
+ * always has the format mpg123 is asked to write in raw mode: signed 16 bit
+ * samples in host byte order, one channel, 44100 Hz. All methods are called
+ * by the thread of the PcmOutput only.
+ */
+class PcmSink {
+public:
+    static const unsigned int SAMPLE_RATE = 44100;
+    static const unsigned int CHANNELS = 1;
+    static const std::size_t FRAME_SIZE = 2 * CHANNELS;
+    /**
+     * Function that creates a sink, e.g. one for each decoder.
+     */
+    typedef std::function<std::unique_ptr<PcmSink>()> Factory;
+    virtual ~PcmSink() {}
+    /**
+     * Get the time it takes to play the given number of bytes.
+     * @param size The number of bytes.
+     * @return The time it takes to play them.
+     */
+    static std::chrono::microseconds getDuration (std::size_t size) {
+        return std::chrono::microseconds (static_cast<long long>(size) *
+                1000000 / (SAMPLE_RATE * FRAME_SIZE));
+    }
+    /**
+     * Open the device.
+     * @return False if the device is not available right now, e.g. because
+     *         another sink is using it.
+     */
+    virtual bool open() = 0;
+    /**
+     * Play the audio that has been written and close the device.
+     */
+    virtual void close() = 0;
+    /**
+     * Discard the audio that has been written but not yet played.
+     */
+    virtual void drop() = 0;
+    /**
+     * Write the given audio. Blocks until the device has room for it.
+     * @param data The audio.
+     * @param size The number of bytes, a multiple of FRAME_SIZE.
+     */
+    virtual void write (const char* data, std::size_t size) = 0;
+    /**
+     * Get the time until the audio written last is heard.
+     * @return The delay of the device.
+     */
+    virtual std::chrono::microseconds getDelay() const = 0;
+};
+
+#endif	/* PCM_SINK_HPP */
+
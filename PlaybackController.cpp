@@ -1,8 +1,13 @@
 #include "PlaybackController.hpp"
+#include "LibraryIndex.hpp"
+#include <boost/asio/io_service.hpp>
+#include <boost/bind.hpp>
 #include <boost/filesystem/operations.hpp>
 #include <boost/optional.hpp>
 #include <boost/none.hpp>
+#include <unistd.h>
 #include <algorithm>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
 #include <sstream>
@@ -12,25 +17,34 @@ using std::string;
 using std::max;
 using std::min;
 using std::vector;
+using std::size_t;
 using std::queue;
 using std::distance;
 using std::advance;
 using std::map;
-using std::find;
 using std::sort;
 using std::endl;
 using std::cout;
+using std::cerr;
+using std::abs;
 using std::istringstream;
+using std::ifstream;
 using std::ostringstream;
+using std::shared_ptr;
+using std::make_shared;
+using std::int64_t;
+using std::uint32_t;
+using std::uint64_t;
 using boost::optional;
+using boost::bind;
+using boost::asio::io_service;
 using boost::filesystem::path;
-using boost::filesystem::directory_iterator;
 using boost::filesystem::exists;
-using boost::filesystem::is_directory;
 using boost::system::error_code;
 using boost::posix_time::ptime;
 using boost::posix_time::microsec_clock;
 using boost::posix_time::seconds;
+using boost::posix_time::milliseconds;
 using boost::posix_time::time_duration;
 
 //==============================================================================
@@ -39,56 +53,109 @@ using boost::posix_time::time_duration;
 const string PlaybackController::CURRENT_ALBUM_FILENAME ("current-album.cfg");
 const string PlaybackController::CURRENT_TITLE_FILENAME ("current-title.cfg");
 const time_duration PlaybackController::FPFI_DURATION (seconds(3));
+const time_duration PlaybackController::STATUS_INTERVAL (seconds(3));
+const time_duration PlaybackController::FAST_PLAY_STATUS_INTERVAL (
+        milliseconds(125));
+const int PlaybackController::MAX_RECOVERIES_AT_POSITION (3);
 
 PlaybackController::PlaybackController (const path& albumsPath,
                                         const path& spokenNumbersPath,
-                                        Mp3Player& mp3Player)
+                                        const path& volumesPath,
+                                        Mp3Player& mp3Player,
+                                        io_service& ioService)
 : _albumsPath (albumsPath)
 , _mp3Player (mp3Player)
-, _albumMap (getAlbumMap(albumsPath))
 , _currentTitlePosition (boost::none)
 , _titlePositionUpdateCycle (100 /* Frames until storing the title position */)
 , _frameCountOfLastUpdateCycle (0)
 , _frameCountPlayed (0)
 , _frameCountTotal (0)
 , _secondsPlayed (0.0)
+, _secondsTotal (0.0)
 , _fastPlayFactor (0)
-, _fastForwardWaitsForLoadCompleted (false)
-, _fastBackwardsWaitsForLoadCompleted (false)
-, _fastBackwardsWaitsForJumpCompleted (false)
+, _fastPlayWaitsForPlayer (false)
 , _numberOfFastPlayedTitles (0)
+, _reloadAfterPrompt (false)
+, _recoveryCount (0)
 , _fastPlayFactorUpdateTime (microsec_clock::local_time())
+, _fastPlaySeekCount (0)
+, _fastPlayDroppedSeekCount (0)
 , _paused (false)
-, _presentingAlbums (false) {
-    for (auto albumMapping : _albumMap) {
-        _albums.push_back (albumMapping.first);
-    }
-    sort (_albums.begin(), _albums.end());
+, _presentingAlbums (false)
+, _libraryComplete (false)
+, _audioStarted (false) {
     _currentAlbumInfo = RebootSafeString (albumsPath, CURRENT_ALBUM_FILENAME);
     _currentAlbum = _currentAlbumInfo.getValue();
-    if (!exists (_currentAlbum)) {
-        DirectoryList::const_iterator albumsBegin = _albums.begin();
-        if (albumsBegin != _albums.end()) {
-            _currentAlbum = *albumsBegin;
+    // Note: For a fast start only the names of the titles of the current
+    // album are read and the playback can be resumed right away. The complete
+    // library including the durations of the titles is built in the
+    // background and handed over in libraryChanged.
+    LibraryScanner::Directory currentAlbum;
+    currentAlbum.path = _currentAlbum;
+    if (!_currentAlbum.empty()) {
+        LibraryScanner::readDirectory(currentAlbum, false);
+    }
+    if (!currentAlbum.files.empty()) {
+        _library = make_shared<const Library>(
+                vector<LibraryScanner::Directory>(1, currentAlbum));
+        _libraryCollection.reset(new LibraryCollection(albumsPath,
+                volumesPath, ioService));
+    } else {
+        vector<LibraryScanner::Directory> directories =
+                LibraryIndex(albumsPath).scan();
+        _library = make_shared<const Library>(directories);
+        _libraryComplete = true;
+        _libraryCollection.reset(new LibraryCollection(_library, directories,
+                volumesPath, ioService));
+        if (_library->getAlbumCount() > 0) {
+            _currentAlbum = _library->getAlbum(0);
         }
     }
-    for (auto itSN = directory_iterator(spokenNumbersPath);
-         itSN != directory_iterator(); ++itSN) {
-        const path& file = *itSN;
-        if (!is_directory(file) && file.extension() == ".mp3") {
-            istringstream iss(file.filename().string());
-            int number;
-            iss >> number;
-            _spokenNumberMap[number] = file;
-        }
+    _libraryCollection->addListener(this);
+    updateCursor();
+    LibraryScanner::Directory spokenNumbers;
+    spokenNumbers.path = spokenNumbersPath;
+    LibraryScanner::readDirectory(spokenNumbers, false);
+    for (const string& file : spokenNumbers.files) {
+        istringstream iss(file);
+        int number;
+        iss >> number;
+        _spokenNumberMap[number] = spokenNumbersPath / file;
     }
     _mp3Player.addListener(this);
+    _mp3Player.setStatusInterval(STATUS_INTERVAL);
 }
 void PlaybackController::setCurrentTitlePosition (const TitlePosition&
                                                   titlePosition) {
     _currentTitlePosition = titlePosition;
     updateCurrentTitleFile();
 }
+path PlaybackController::setCurrentTitle (size_t title, int frameCount) {
+    _cursor->title = title;
+    _cursor->titleFound = true;
+    const path titlePath = _library->getTitle(_cursor->album, title);
+    setCurrentTitlePosition (TitlePosition (titlePath, frameCount));
+    return titlePath;
+}
+void PlaybackController::updateCursor () {
+    optional<Library::AlbumId> album = _library->findAlbum(_currentAlbum);
+    if (!album) {
+        _cursor = boost::none;
+        return;
+    }
+    Cursor cursor = {*album, 0, false};
+    if (_presentingAlbums) {
+        // Note: While presenting the albums the first title of the current
+        // album is played, the current title position belongs to the album
+        // presented before.
+        cursor.titleFound = _library->getTitleCount(*album) > 0;
+    } else if (_currentTitlePosition) {
+        const path title = _currentTitlePosition.get().getTitle();
+        cursor.title = _library->findTitle(*album, title.filename().string(),
+                                           &cursor.titleFound);
+    }
+    _cursor = cursor;
+}
 void PlaybackController::setCurrentTitlePosition (int frameCount) {
     // During the album selection the current title position is not stored.
     if (_presentingAlbums) {
@@ -113,17 +180,12 @@ optional<PlaybackController::TitlePosition> PlaybackController::
     getline (iss, title);
     const TitlePosition titlePosition (path(title), frameCount);
     if (!exists (titlePosition.getTitle())) {
-        map<path, DirectoryList>::const_iterator itMap = _albumMap.find(album);
-        if (itMap == _albumMap.end()) {
-            return boost::none;
-        }
-        const DirectoryList& mp3Files = itMap->second;
-        DirectoryList::const_iterator mp3FilesBegin = mp3Files.begin();
-        if (mp3FilesBegin != mp3Files.end()) {
-            return optional<TitlePosition> (TitlePosition (*mp3FilesBegin, 0));
-        } else {
+        optional<Library::AlbumId> albumId = _library->findAlbum(album);
+        if (!albumId || _library->getTitleCount(*albumId) == 0) {
             return boost::none;
         }
+        return optional<TitlePosition> (TitlePosition (
+                _library->getTitle(*albumId, 0), 0));
     }
     return titlePosition;
 }
@@ -140,135 +202,150 @@ void PlaybackController::updateCurrentTitleFile () {
         _currentTitleInfo = RebootSafeString(_currentTitleInfo, ost.str());
     }
 }
-optional<path> PlaybackController::getFirstTitle () const {
-    auto itFoundInMap = _albumMap.find(_currentAlbum);
-    if (itFoundInMap != _albumMap.end()) {
-        const DirectoryList& mp3Files = itFoundInMap->second;
-        auto itFirst = mp3Files.begin();
-        if (itFirst != mp3Files.end()) {
-            return optional<path>(*itFirst);
-        }
+optional<size_t> PlaybackController::getFirstTitle () const {
+    if (_cursor && _library->getTitleCount(_cursor->album) > 0) {
+        return optional<size_t>(0);
     }
     return boost::none;
 }
-optional<path> PlaybackController::getNextTitle (int stepSize,
-                                                 bool wrapAround) const {
-    if (_currentTitlePosition) {
-        TitlePosition currentTitlePosition = _currentTitlePosition.get();
-        auto itFoundInMap = _albumMap.find(_currentAlbum);
-        if (itFoundInMap != _albumMap.end()) {
-            const DirectoryList& mp3Files = itFoundInMap->second;
-            auto itCurrent = find (mp3Files.begin(), mp3Files.end(),
-                                   currentTitlePosition.getTitle());
-            if (itCurrent != mp3Files.end()) {
-                int i=0;
-                while (i < stepSize && itCurrent != mp3Files.end()) {
-                    i++;
-                    itCurrent++;
-                }
-                if (wrapAround && itCurrent == mp3Files.end()) {
-                    itCurrent = mp3Files.begin();
-                }
-                if (itCurrent != mp3Files.end()) {
-                    return optional<path>(*itCurrent);
-                }
-            }
+optional<size_t> PlaybackController::getNextTitle (int stepSize,
+                                                   bool wrapAround) const {
+    if (_currentTitlePosition && _cursor) {
+        size_t titleCount = _library->getTitleCount(_cursor->album);
+        // Note: If the current title has been removed from the library
+        // meanwhile the cursor already points to the title after it.
+        size_t title = _cursor->title + stepSize;
+        if (!_cursor->titleFound) {
+            title--;
+        }
+        title = min (title, titleCount);
+        if (wrapAround && title == titleCount) {
+            title = 0;
+        }
+        if (title < titleCount) {
+            return optional<size_t>(title);
         }
     }
     return boost::none;
 }
-optional<path> PlaybackController::getPreviousTitle (int stepSize) const {
-    if (_currentTitlePosition) {
-        TitlePosition currentTitlePosition = _currentTitlePosition.get();
-        auto itFoundInMap = _albumMap.find(_currentAlbum);
-        if (itFoundInMap != _albumMap.end()) {
-            const DirectoryList& mp3Files = itFoundInMap->second;
-            auto itCurrent = find (mp3Files.begin(), mp3Files.end(),
-                                   currentTitlePosition.getTitle());
-            if (itCurrent != mp3Files.begin()) {
-                int i=0;
-                while (i < stepSize && itCurrent != mp3Files.begin()) {
-                    i++;
-                    itCurrent--;
-                }
-                return optional<path>(*itCurrent);
-            }
-        }
+optional<size_t> PlaybackController::getPreviousTitle (int stepSize) const {
+    if (_currentTitlePosition && _cursor && _cursor->title > 0) {
+        return optional<size_t>(_cursor->title -
+                                min<size_t> (_cursor->title, stepSize));
     }
     return boost::none;
 }
 bool PlaybackController::isLastTitle () const {
-    if (_currentTitlePosition) {
-        TitlePosition currentTitlePosition = _currentTitlePosition.get();
-        auto itFoundInMap = _albumMap.find(_currentAlbum);
-        if (itFoundInMap != _albumMap.end()) {
-            const DirectoryList& mp3Files = itFoundInMap->second;
-            auto itCurrent = find (mp3Files.begin(), mp3Files.end(),
-                                   currentTitlePosition.getTitle());
-            if (itCurrent != mp3Files.end()) {
-                itCurrent++;
-                return (itCurrent == mp3Files.end());
-            }
-        }
+    if (_currentTitlePosition && _cursor) {
+        size_t title = _cursor->titleFound ? _cursor->title + 1 :
+                                             _cursor->title;
+        return (title == _library->getTitleCount(_cursor->album));
     }
     return false;
 }
 int PlaybackController::getCurrentTitleNumber () const {
-    int n=0;
-    if (_currentTitlePosition) {
-        TitlePosition currentTitlePosition = _currentTitlePosition.get();
-        auto itFoundInMap = _albumMap.find(_currentAlbum);
-        if (itFoundInMap != _albumMap.end()) {
-            const DirectoryList& mp3Files = itFoundInMap->second;
-            for (auto it = mp3Files.begin(); it != mp3Files.end(); ++it) {
-                path file = *it;
-                if (!is_directory(file) && file.extension() == ".mp3") {
-                    n++;
-                    if (file == currentTitlePosition.getTitle()) {
-                        break;
-                    }
-                }
-            }
-        }
+    if (_currentTitlePosition && _cursor) {
+        return _cursor->titleFound ? _cursor->title + 1 : _cursor->title;
     }
-    return n;
-}
-map<path, vector<path>> PlaybackController::getAlbumMap(const Path& albums) {
-    map<path, vector<path>> albumMap;
-    for (auto itAF = directory_iterator(albums); itAF != directory_iterator();
-         ++itAF) {
-        const path& file = *itAF;
-        if (is_directory(file)) {
-            map<Path, DirectoryList> nextAlbumMap = getAlbumMap(file);
-            albumMap.insert(nextAlbumMap.begin(), nextAlbumMap.end());
-        } else if (file.extension() == ".mp3") {
-            DirectoryList& mp3Files = albumMap[albums];
-            mp3Files.push_back(file);
-        }
+    return 0;
+}
+bool PlaybackController::isAlbumDurationKnown() const {
+    return _cursor &&
+           _library->getAlbumDuration(_cursor->album).getFrameCount() > 0;
+}
+bool PlaybackController::stepAlbumPosition (int frameCount, int frameStep) {
+    if (!_cursor || !_cursor->titleFound || !isAlbumDurationKnown()) {
+        return false;
     }
-    map<Path, DirectoryList>::iterator itFound = albumMap.find(albums);
-    if (itFound != albumMap.end()) {
-        DirectoryList& mp3Files = itFound->second;
-        sort (mp3Files.begin(), mp3Files.end());
+    Library::AlbumId album = _cursor->album;
+    int64_t albumFrameCount =
+            _library->getAlbumDuration(album).getFrameCount();
+    int64_t albumFrame = _library->getTitleStart(album, _cursor->title).
+            getFrameCount() + static_cast<int64_t>(frameCount) + frameStep;
+    albumFrame = max<int64_t> (0, min (albumFrame, albumFrameCount - 1));
+    size_t title = _library->findTitleAtFrame(album, albumFrame);
+    if (title == _cursor->title) {
+        return false;
     }
-    return albumMap;
+    setCurrentTitle (title, albumFrame -
+                     _library->getTitleStart(album, title).getFrameCount());
+    return true;
 }
 void PlaybackController::startFastPlay (int factor) {
     if (_fastPlayFactor != factor) {
+        if (_fastPlayFactor == 0) {
+            _fastPlaySeekCount = _mp3Player.getSeekCount();
+            _fastPlayDroppedSeekCount = _mp3Player.getDroppedSeekCount();
+        } else if (factor == 0) {
+            cout << "Fast play: " << _mp3Player.getSeekCount() -
+                    _fastPlaySeekCount << " seeks, "
+                 << _mp3Player.getDroppedSeekCount() -
+                    _fastPlayDroppedSeekCount << " obsolete seeks dropped"
+                 << endl;
+        }
         _fastPlayFactor = factor;
         _fastPlayFactorUpdateTime = microsec_clock::local_time();
-        _fastForwardWaitsForLoadCompleted = false;
-        _fastBackwardsWaitsForLoadCompleted = false;
-        _fastBackwardsWaitsForJumpCompleted = false;
+        _mp3Player.setStatusInterval((factor == 0) ? STATUS_INTERVAL :
+                                     FAST_PLAY_STATUS_INTERVAL);
+        _fastPlayWaitsForPlayer = false;
         _numberOfFastPlayedTitles = 0;
         _numbersToSay = queue<int>();
         // Probably last frame has not been stored, therefore store for sure.
-        setCurrentTitlePosition(_frameCountPlayed);
+        setCurrentTitlePosition(_mp3Player.getFrameCount());
     }
 }
 void PlaybackController::stopFastPlay () {
     startFastPlay(0);
 }
+int PlaybackController::getFramesPerSecond() const {
+    int framesPerSecond = _frameCountTotal /
+        (static_cast<int>(_secondsTotal) + 1);
+    if (isAlbumDurationKnown() && _cursor->titleFound) {
+        // Note: The frame rate of the title is known exactly from the library.
+        Mp3Duration titleDuration = _library->getTitleDuration(_cursor->album,
+                                                               _cursor->title);
+        if (titleDuration.getMilliseconds() > 0) {
+            framesPerSecond = static_cast<uint64_t>(
+                    titleDuration.getFrameCount()) * 1000 /
+                    titleDuration.getMilliseconds();
+        }
+    }
+    return framesPerSecond;
+}
+int PlaybackController::getFastPlayTitleStepSize() const {
+    if (_numberOfFastPlayedTitles > 100) {
+        return 100;
+    } else if (_numberOfFastPlayedTitles > 10) {
+        return 10;
+    }
+    return 1;
+}
+void PlaybackController::fastPlayPositionReached() {
+    _fastPlayWaitsForPlayer = false;
+    _numberOfFastPlayedTitles += getFastPlayTitleStepSize();
+    // Note: The handler is called right after the status of the reached
+    // position, so the next step does not have to wait for another status.
+    if (_fastPlayFactor != 0 && _numbersToSay.empty()) {
+        fastPlayStep(_frameCountPlayed);
+    }
+}
+void PlaybackController::fastBackwardsTitleLoaded() {
+    // Note: The frame counts of the loaded title are already known, since
+    // the handler is called after its first frame has been reported.
+    _mp3Player.jumpTo(_frameCountTotal - getFramesPerSecond(),
+            bind(&PlaybackController::fastPlayPositionReached, this));
+}
+void PlaybackController::preloadNextTitle() {
+    // Note: During fast-play the next title is hardly ever played from its
+    // beginning.
+    if (_fastPlayFactor == 0) {
+        optional<size_t> nextTitle = getNextTitle(1, false /* no wrap */);
+        if (nextTitle) {
+            _mp3Player.preload(_library->getTitle(_cursor->album,
+                                                  nextTitle.get()));
+        }
+    }
+}
 void PlaybackController::say(int number) {
     if (number <= 100) {
         _numbersToSay.push(number);
@@ -282,12 +359,13 @@ void PlaybackController::say(int number) {
 }
 void PlaybackController::sayNextNumber() {
     int nextNumber = _numbersToSay.front();
-    _mp3Player.load(_spokenNumberMap[nextNumber]);
+    _mp3Player.playPrompt(_spokenNumberMap[nextNumber]);
 }
 bool PlaybackController::resume() {
     stopFastPlay();
     _paused = false;
     _currentTitlePosition = getCurrentTitlePosition (_currentAlbum);
+    updateCursor();
     if (_currentTitlePosition) {
         TitlePosition currentTitlePosition = _currentTitlePosition.get();
         _mp3Player.load(currentTitlePosition.getTitle());
@@ -299,19 +377,26 @@ bool PlaybackController::resume() {
 }
 void PlaybackController::pause() {
     stopFastPlay();
-    if (_paused) {
+    if (_paused && _mp3Player.isPaused()) {
+        // Note: The title is still loaded, so it just continues.
+        _paused = false;
+        _numbersToSay = queue<int>();
+        _mp3Player.stopPrompt();
+        _mp3Player.setPaused(false);
+    } else if (_paused) {
         resume();
     } else {
         _paused = true;
+        setCurrentTitlePosition(_mp3Player.getFrameCount());
+        // Note: The player pauses the title while the number is said.
         say (getCurrentTitleNumber());
     }
 }
 bool PlaybackController::next (bool wrapAround) {
     stopFastPlay();
-    optional<path> nextTitle = getNextTitle(1, wrapAround);
+    optional<size_t> nextTitle = getNextTitle(1, wrapAround);
     if (nextTitle) {
-        setCurrentTitlePosition (TitlePosition (nextTitle.get(), 0));
-        _mp3Player.load (nextTitle.get());
+        _mp3Player.load (setCurrentTitle (nextTitle.get()));
         return true;
     }
     return false;
@@ -322,10 +407,9 @@ bool PlaybackController::back() {
         _mp3Player.jumpToBegin();
         return true;
     } else {
-        optional<path> previousTitle = getPreviousTitle(1);
+        optional<size_t> previousTitle = getPreviousTitle(1);
         if (previousTitle) {
-            setCurrentTitlePosition (TitlePosition (previousTitle.get(), 0));
-            _mp3Player.load (previousTitle.get());
+            _mp3Player.load (setCurrentTitle (previousTitle.get()));
         } else {
             _mp3Player.jumpToBegin();
         }
@@ -334,16 +418,15 @@ bool PlaybackController::back() {
     return false;
 }
 void PlaybackController::fastForward () {
+    startFastPlay(2);
     if (isLastTitle() && _frameCountPlayed + 1 >= _frameCountTotal) {
-        optional<path> firstTitle = getFirstTitle();
+        optional<size_t> firstTitle = getFirstTitle();
         if (firstTitle) {
-            TitlePosition firstTitleTP = TitlePosition(firstTitle.get(), 0);
-            setCurrentTitlePosition (firstTitleTP);
-            _mp3Player.load (firstTitle.get());
-            _fastForwardWaitsForLoadCompleted = true;
+            _fastPlayWaitsForPlayer = true;
+            _mp3Player.load (setCurrentTitle (firstTitle.get()), true,
+                    bind(&PlaybackController::fastPlayPositionReached, this));
         }
     }
-    startFastPlay(2);
 }
 void PlaybackController::fastBackwards () {
     startFastPlay(-2);
@@ -351,19 +434,26 @@ void PlaybackController::fastBackwards () {
         path currentTitle = _currentTitlePosition.get().getTitle();
         TitlePosition currentTitlePosition = TitlePosition(currentTitle, 0);
         setCurrentTitlePosition (currentTitlePosition);
-        _mp3Player.load (currentTitle);
-        _fastBackwardsWaitsForLoadCompleted = true;
+        _fastPlayWaitsForPlayer = true;
+        _mp3Player.load (currentTitle, true,
+                bind(&PlaybackController::fastBackwardsTitleLoaded, this));
         return;
     }
 }
 void PlaybackController::jumpToAlbum (int n) {
     stopFastPlay();
-    auto itCurrent = _albums.begin();
-    if (n > 0) {
-        advance (itCurrent, min<int> (_albums.size() - 1, n - 1));
+    if (!_libraryComplete) {
+        // Note: The album numbers are known as soon as the library is complete.
+        _pendingAlbumNumber = n;
+        return;
     }
-    if (itCurrent != _albums.end()) {
-        _currentAlbum = *itCurrent;
+    size_t albumCount = _library->getAlbumCount();
+    if (albumCount > 0) {
+        Library::AlbumId album = 0;
+        if (n > 0) {
+            album = min<int> (albumCount - 1, n - 1);
+        }
+        _currentAlbum = _library->getAlbum(album);
         _currentAlbumInfo = RebootSafeString (_currentAlbumInfo,
                                               _currentAlbum.string());
         resume();
@@ -371,52 +461,119 @@ void PlaybackController::jumpToAlbum (int n) {
 }
 void PlaybackController::presentNextAlbum() {
     stopFastPlay();
-    _presentingAlbums = true;
-    auto itCurrent = find (_albums.begin(), _albums.end(), _currentAlbum);
-    if (itCurrent == _albums.end()) {
-        itCurrent = _albums.begin();
-    } else {
-        itCurrent++;
-    }
-    if (itCurrent == _albums.end()) {
-        itCurrent = _albums.begin();
-    }
-    if (itCurrent == _albums.end()) {
+    size_t albumCount = _library->getAlbumCount();
+    if (!_libraryComplete || albumCount == 0) {
         return;
     }
-    const path& currentAlbum = *itCurrent;
-    map<path, DirectoryList>::const_iterator itMap =
-            _albumMap.find(currentAlbum);
-    if (itMap == _albumMap.end()) {
-        return;
+    _presentingAlbums = true;
+    Library::AlbumId nextAlbum = 0;
+    if (_cursor && _cursor->album + 1 < albumCount) {
+        nextAlbum = _cursor->album + 1;
     }
-    const DirectoryList& mp3Files = itMap->second;
-    if (mp3Files.size() == 0) {
+    const path currentAlbum = _library->getAlbum(nextAlbum);
+    if (_library->getTitleCount(nextAlbum) == 0) {
         return;
     }
-    const path& firstTitleInAlbum = *(mp3Files.begin());
+    const path firstTitleInAlbum = _library->getTitle(nextAlbum, 0);
     _mp3Player.load (firstTitleInAlbum);
     _currentAlbumInfo = RebootSafeString (_currentAlbumInfo, currentAlbum.string());
     _currentAlbum = currentAlbum;
+    _cursor = Cursor {nextAlbum, 0, true};
 }
 void PlaybackController::resumeAlbum() {
     stopFastPlay();
     _presentingAlbums = false;
     resume();
 }
+bool PlaybackController::seekInAlbum (const time_duration& albumTime) {
+    stopFastPlay();
+    if (!_cursor || albumTime.is_negative() || _presentingAlbums) {
+        return false;
+    }
+    Library::AlbumId album = _cursor->album;
+    uint32_t albumMilliseconds = albumTime.total_milliseconds();
+    size_t title = _library->findTitleAtTime(album, albumMilliseconds);
+    if (title >= _library->getTitleCount(album)) {
+        return false;
+    }
+    // Note: All frames of a title have the same duration, therefore the
+    // frame is proportional to the time within the title.
+    Mp3Duration titleDuration = _library->getTitleDuration(album, title);
+    uint64_t titleMilliseconds = albumMilliseconds -
+            _library->getTitleStart(album, title).getMilliseconds();
+    int frameCount = titleMilliseconds * titleDuration.getFrameCount() /
+            titleDuration.getMilliseconds();
+    _paused = false;
+    _mp3Player.load (setCurrentTitle (title, frameCount));
+    _mp3Player.jumpTo(frameCount);
+    return true;
+}
+optional<time_duration> PlaybackController::getRemainingAlbumTime() const {
+    if (!_cursor || !isAlbumDurationKnown()) {
+        return boost::none;
+    }
+    Library::AlbumId album = _cursor->album;
+    uint64_t albumMilliseconds =
+            _library->getAlbumDuration(album).getMilliseconds();
+    if (_cursor->title >= _library->getTitleCount(album)) {
+        return time_duration(boost::posix_time::milliseconds(0));
+    }
+    uint64_t playedMilliseconds =
+            _library->getTitleStart(album, _cursor->title).getMilliseconds();
+    Mp3Duration titleDuration = _library->getTitleDuration(album,
+                                                           _cursor->title);
+    if (_cursor->titleFound && _currentTitlePosition &&
+        titleDuration.getFrameCount() > 0) {
+        uint64_t frameCount = min<uint64_t> (titleDuration.getFrameCount(),
+                max (_currentTitlePosition.get().getFrameCount(), 0));
+        playedMilliseconds += frameCount * titleDuration.getMilliseconds() /
+                titleDuration.getFrameCount();
+    }
+    return time_duration(boost::posix_time::milliseconds(
+            albumMilliseconds - min (albumMilliseconds, playedMilliseconds)));
+}
+void PlaybackController::libraryChanged (
+        const shared_ptr<const Library>& library) {
+    // Note: The numbers of the current album and title may have changed in the
+    // new snapshot, therefore the cursor is looked up again by the paths.
+    _library = library;
+    updateCursor();
+    if (!_libraryComplete) {
+        _libraryComplete = true;
+        cout << "Library complete with " << _library->getAlbumCount()
+             << " albums and " << _library->getTitleCount() << " titles."
+             << endl;
+        if (_pendingAlbumNumber) {
+            int n = _pendingAlbumNumber.get();
+            _pendingAlbumNumber = boost::none;
+            size_t albumCount = _library->getAlbumCount();
+            if (albumCount > 0 && _library->getAlbum(
+                    min<int> (albumCount - 1, max (n, 1) - 1)) !=
+                        _currentAlbum) {
+                jumpToAlbum(n);
+            }
+        }
+    }
+}
 void PlaybackController::mpg123Version (const string& message) {
 }
 void PlaybackController::titleLoaded (const Mp3Title& title) {
-    if (_numbersToSay.empty()) {
-        cout << "Playing title " << title.toString() << endl;
-        _frameCountOfLastUpdateCycle = 0;
-    }
+    cout << "Playing title " << title.toString() << " (loaded in "
+         << _mp3Player.getLastLoadTime().count() << " us)" << endl;
+    _reloadAfterPrompt = false;
+    _frameCountOfLastUpdateCycle = 0;
+    preloadNextTitle();
 }
 void PlaybackController::playStatus (int framecount, int framesLeft,
         float seconds, float secondsLeft) {
+    if (!_audioStarted) {
+        _audioStarted = true;
+        logTimeToAudio();
+    }
     _frameCountPlayed = framecount;
     _frameCountTotal = framecount + framesLeft;
     _secondsPlayed = seconds;
+    _secondsTotal = seconds + secondsLeft;
     if (framecount - _frameCountOfLastUpdateCycle > _titlePositionUpdateCycle) {
         _frameCountOfLastUpdateCycle = framecount;
         setCurrentTitlePosition(framecount);
@@ -430,58 +587,41 @@ void PlaybackController::playStatus (int framecount, int framesLeft,
         _fastPlayFactor <<= 1;
         _fastPlayFactorUpdateTime = tNow;
     }
-    float secondsTotal = seconds + secondsLeft;
-    int framesPerSecond = _frameCountTotal /
-        (static_cast<int>(secondsTotal) + 1);
-    int titleStepSize = 1;
-    if (_numberOfFastPlayedTitles > 10 && _numberOfFastPlayedTitles <= 100) {
-        titleStepSize = 10;
-    } else if (_numberOfFastPlayedTitles > 100) {
-        titleStepSize = 100;
-    }
-    if (!_numbersToSay.empty()) {
-        return;
-    } else if (_fastForwardWaitsForLoadCompleted) {
-        if (_mp3Player.isLoadCompleted()) {
-            _fastForwardWaitsForLoadCompleted = false;
-            _numberOfFastPlayedTitles+=titleStepSize;
-        } else {
-            return;
-        }
-    } else if (_fastBackwardsWaitsForLoadCompleted) {
-        if (_mp3Player.isLoadCompleted()) {
-            _mp3Player.jumpTo(_frameCountTotal - framesPerSecond);
-            _fastBackwardsWaitsForLoadCompleted = false;
-            _fastBackwardsWaitsForJumpCompleted = true;
-            _numberOfFastPlayedTitles+=titleStepSize;
-        }
+    if (!_numbersToSay.empty() || _fastPlayWaitsForPlayer) {
         return;
-    } else  if (_fastBackwardsWaitsForJumpCompleted) {
-        if (!_mp3Player.isJumpToCompleted()) {
-            return;
-        } else {
-            _fastBackwardsWaitsForJumpCompleted = false;
-        }
     }
+    fastPlayStep(framecount);
+}
+void PlaybackController::fastPlayStep (int framecount) {
+    int framesPerSecond = getFramesPerSecond();
+    int titleStepSize = getFastPlayTitleStepSize();
     int framesPerEighthOfSecond = framesPerSecond >> 3;
     int frameJump = framesPerEighthOfSecond * _fastPlayFactor;
     int nextFrameCount = framecount + frameJump;
-    if (nextFrameCount > _frameCountTotal) {
-        optional<path> nextTitle = getNextTitle(titleStepSize,
-                                                false /* no wrap-around. */);
+    if ((nextFrameCount > _frameCountTotal || nextFrameCount < 0) &&
+        isAlbumDurationKnown()) {
+        // Note: The target title and frame are known exactly, so the step is
+        // not limited to the next or previous title.
+        if (stepAlbumPosition(framecount, frameJump)) {
+            say (getCurrentTitleNumber());
+            return;
+        }
+        nextFrameCount = (nextFrameCount < 0) ? framesPerSecond :
+                (_frameCountTotal - framesPerSecond);
+    } else if (nextFrameCount > _frameCountTotal) {
+        optional<size_t> nextTitle = getNextTitle(titleStepSize,
+                                                  false /* no wrap-around. */);
         if (nextTitle) {
-            TitlePosition nextTP = TitlePosition(nextTitle.get(), 0);
-            setCurrentTitlePosition (nextTP);
+            setCurrentTitle (nextTitle.get());
             say (getCurrentTitleNumber());
             return;
         } else {
             nextFrameCount = _frameCountTotal - framesPerSecond;
         }
     } else if (nextFrameCount < 0) {
-        optional<path> previousTitle = getPreviousTitle(titleStepSize);
+        optional<size_t> previousTitle = getPreviousTitle(titleStepSize);
         if (previousTitle) {
-            TitlePosition previousTP = TitlePosition(previousTitle.get(), 0);
-            setCurrentTitlePosition (previousTP);
+            setCurrentTitle (previousTitle.get());
             say (getCurrentTitleNumber());
             return;
         } else {
@@ -491,25 +631,47 @@ void PlaybackController::playStatus (int framecount, int framesLeft,
     _mp3Player.jumpTo(nextFrameCount);
 }
 void PlaybackController::playingStopped (bool endOfSongReached) {
+    if (!_paused && !_presentingAlbums) {
+        if (_fastPlayFactor == 0) {
+            next(false /* no wrap-around */);
+        } else {
+            continueFastPlay();
+        }
+    }
+}
+void PlaybackController::promptPlayed() {
     if (!_numbersToSay.empty()) {
         _numbersToSay.pop();
     }
     if (!_numbersToSay.empty()) {
         sayNextNumber();
     } else if (!_paused && !_presentingAlbums) {
-        if (_fastPlayFactor == 0) {
-            next(false /* no wrap-around */);
+        if (_fastPlayFactor == 0 && _reloadAfterPrompt) {
+            reloadCurrentTitle();
+        } else if (_fastPlayFactor == 0) {
+            _mp3Player.setPaused(false);
         } else {
-            TitlePosition currentTitlePosition = _currentTitlePosition.get();
-            _mp3Player.load(currentTitlePosition.getTitle());
-            if (_fastPlayFactor > 0) {
-                _fastForwardWaitsForLoadCompleted = true;
-            } else if (_fastPlayFactor < 0) {
-                _fastBackwardsWaitsForLoadCompleted = true;
-            }
+            continueFastPlay();
         }
     }
 }
+void PlaybackController::continueFastPlay() {
+    TitlePosition currentTitlePosition = _currentTitlePosition.get();
+    _fastPlayWaitsForPlayer = true;
+    if (isAlbumDurationKnown()) {
+        // Note: The position within the title has been determined
+        // from the frame counts of the library.
+        _mp3Player.load(currentTitlePosition.getTitle());
+        _mp3Player.jumpTo(currentTitlePosition.getFrameCount(),
+                bind(&PlaybackController::fastPlayPositionReached, this));
+    } else if (_fastPlayFactor > 0) {
+        _mp3Player.load(currentTitlePosition.getTitle(), true,
+                bind(&PlaybackController::fastPlayPositionReached, this));
+    } else {
+        _mp3Player.load(currentTitlePosition.getTitle(), true,
+                bind(&PlaybackController::fastBackwardsTitleLoaded, this));
+    }
+}
 void PlaybackController::playingPaused() {
 }
 void PlaybackController::playingUnpaused() {
@@ -519,9 +681,81 @@ void PlaybackController::playingErrorOccurred (
 }
 void PlaybackController::mpg123CommunicationProblem (
         const error_code& error) {
+    recoverPlayback();
 }
 void PlaybackController::mpg123Terminated (
         int waitpidStatus) {
+    recoverPlayback();
+}
+void PlaybackController::recoverPlayback() {
+    if (_paused || !_currentTitlePosition) {
+        // Note: When the pause ends the title is loaded anyway, since the
+        // new mpg123 is not paused.
+        return;
+    }
+    if (_presentingAlbums) {
+        if (_cursor && _library->getTitleCount(_cursor->album) > 0) {
+            _mp3Player.load(_library->getTitle(_cursor->album, 0));
+        }
+    } else if (!_numbersToSay.empty()) {
+        // Note: Loading the title would stop the number being said.
+        _reloadAfterPrompt = true;
+    } else if (_fastPlayFactor != 0) {
+        continueFastPlay();
+    } else {
+        // Note: The stored position moves on a little with each recovery,
+        // so positions within one update cycle are considered the same.
+        const TitlePosition& position = _currentTitlePosition.get();
+        if (_recoveryPosition &&
+            _recoveryPosition.get().getTitle() == position.getTitle() &&
+            abs(_recoveryPosition.get().getFrameCount() -
+                position.getFrameCount()) <= _titlePositionUpdateCycle) {
+            _recoveryCount++;
+        } else {
+            _recoveryCount = 1;
+        }
+        _recoveryPosition = position;
+        if (_recoveryCount > MAX_RECOVERIES_AT_POSITION) {
+            cerr << "Unable to play " << position.getTitle().string()
+                 << ", continuing with the next title." << endl;
+            _recoveryPosition = boost::none;
+            next(false /* no wrap-around */);
+        } else {
+            reloadCurrentTitle();
+        }
+    }
+}
+void PlaybackController::reloadCurrentTitle() {
+    _reloadAfterPrompt = false;
+    TitlePosition currentTitlePosition = _currentTitlePosition.get();
+    _mp3Player.load(currentTitlePosition.getTitle());
+    _mp3Player.jumpTo(currentTitlePosition.getFrameCount());
+}
+void PlaybackController::logTimeToAudio() const {
+    // Note: The start time of the process is given in clock ticks since boot.
+    // The fields are counted after the name of the program since the name may
+    // contain spaces.
+    ifstream statFile ("/proc/self/stat");
+    string stat;
+    getline (statFile, stat);
+    size_t nameEnd = stat.rfind(')');
+    if (nameEnd == string::npos) {
+        return;
+    }
+    istringstream issStat (stat.substr(nameEnd + 1));
+    string field;
+    for (int i=3; i<22; i++) {
+        issStat >> field;
+    }
+    unsigned long long startTime = 0;
+    issStat >> startTime;
+    double uptime = 0.0;
+    ifstream uptimeFile ("/proc/uptime");
+    uptimeFile >> uptime;
+    double processStart = static_cast<double>(startTime) / sysconf(_SC_CLK_TCK);
+    cout << "Audio started " << static_cast<int>((uptime - processStart) * 1000)
+         << " ms after start of program, "
+         << static_cast<int>(uptime * 1000) << " ms after boot." << endl;
 }
 //==============================================================================
 //------------------- PlaybackController::TitlePosition ------------------------
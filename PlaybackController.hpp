@@ -1,17 +1,24 @@
 #ifndef PLAYBACK_CONTROLLER_HPP
 #define	PLAYBACK_CONTROLLER_HPP
 
+#include "Library.hpp"
+#include "LibraryCollection.hpp"
 #include "Mp3Player.hpp"
 #include "RebootSafeString.hpp"
 #include <boost/date_time/posix_time/ptime.hpp>
 #include <boost/date_time/posix_time/posix_time_duration.hpp>
 #include <boost/optional.hpp>
 #include <boost/filesystem/path.hpp>
+#include <cstddef>
 #include <vector>
 #include <queue>
 #include <map>
+#include <memory>
 
 namespace boost {
+    namespace asio {
+        class io_service;
+    }
     namespace system {
         class error_code;
     }
@@ -21,7 +28,8 @@ namespace boost {
  * Class that controls the play back of the titles from different albums.
  * Uses an Mp3Player to play the titles.
  */
-class PlaybackController : public virtual Mp3Player::IListener {
+class PlaybackController : public virtual Mp3Player::IListener,
+                           public virtual LibraryCollection::IListener {
 public:
     typedef boost::filesystem::path Path;
     /**
@@ -33,15 +41,29 @@ public:
      * After a title has been played the playback controller automatically
      * starts playing the next title. If the end is reached the automatic
      * playback stops.
+     * Albums and titles added to or removed from the albums directory later
+     * on are taken over while playing.
+     * Only the current album is read in the constructor so that the playback
+     * can be resumed immediately. The other albums are added in the
+     * background. Until then jumping to another album is deferred and
+     * presenting the albums is not possible.
      * @param albumsPath The directory containing one sub-directory for each
      *                   album. The album directories contain the mp3 files.
      * @param spokenNumbersPath The directory containing spoken numbers in
      *                          mp3 format.
+     * @param volumesPath The directory below which volumes (e.g. USB sticks)
+     *                    are mounted. Their albums are added to the albums
+     *                    of the albums directory. If empty no volumes are
+     *                    used.
      * @param mp3Player The Mp3Player instance that is controlled to play
      *                  the titles.
+     * @param ioService The io_service in which changes of the albums
+     *                  directory are reported. Has to be the same io_service
+     *                  as used for the mp3Player.
      */
     PlaybackController (const Path& albumsPath, const Path& spokenNumbersPath,
-                        Mp3Player& mp3Player);
+                        const Path& volumesPath, Mp3Player& mp3Player,
+                        boost::asio::io_service& ioService);
     /**
      * Start the playback of the current album title and frame if at least one
      * valid MP3 album has been found in the albums path that has been given to
@@ -126,6 +148,29 @@ public:
      * is not current title file.
      */
     void resumeAlbum();
+    /**
+     * Continue the current album at the given time as if the album had been
+     * played from its beginning. The title and the frame are looked up in the
+     * durations of the titles stored in the library, so even in albums with
+     * hundreds of titles this is a single jump.
+     * @param albumTime The time since the beginning of the album.
+     * @return True if the position has been found. False if the durations of
+     *         the titles are not known (yet) or if the time is beyond the end
+     *         of the album.
+     */
+    bool seekInAlbum (const boost::posix_time::time_duration& albumTime);
+    /**
+     * Get the time until the end of the current album is reached.
+     * @return The sum of the rest of the current title and the durations of
+     *         the following titles. None if the durations are not known (yet).
+     */
+    boost::optional<boost::posix_time::time_duration> getRemainingAlbumTime()
+            const;
+    /**
+     * @see LibraryCollection#IListener#libraryChanged
+     */
+    void libraryChanged (
+            const std::shared_ptr<const Library>& library) override;
     /**
      * @see Mp3Player#IListener#mpg123Version
      */
@@ -164,12 +209,12 @@ public:
      * @see Mp3Player#IListener#mpg123Terminated
      */
     void mpg123Terminated (int waitpidStatus) override;
-
-protected:
     /**
-     * Typedef DirectoryList for better readability of vector<path>.
+     * @see Mp3Player#IListener#promptPlayed
      */
-    typedef std::vector<Path> DirectoryList;
+    void promptPlayed() override;
+
+protected:
     /**
      * Listener for the Mp3Player. Note the its methods are called in the
      * Mp3Player's io_service.
@@ -227,12 +272,40 @@ protected:
         Path _title;
         int _frameCount;
     };
+    /**
+     * The position of the current album and title within the library. Allows
+     * to navigate between the titles without searching the library.
+     */
+    struct Cursor {
+        /** The number of the current album. */
+        Library::AlbumId album;
+        /** The number of the current title within the album. If the current
+         *  title is not part of the library (e.g. because it has been removed)
+         *  the number of the title after it. */
+        std::size_t title;
+        /** True if the current title is part of the library. */
+        bool titleFound;
+    };
     /**
      * Set the given title position to be the title currently played and
      * remember this permanently in the current title file.
      * @param titlePosition The new title position being played.
      */
     void setCurrentTitlePosition (const TitlePosition& titlePosition);
+    /**
+     * Set the given title of the current album to be the title position
+     * currently played and move the cursor to this title.
+     * @param title The number of the title within the current album.
+     * @param frameCount The position within the title.
+     * @return The path of the title.
+     */
+    Path setCurrentTitle (std::size_t title, int frameCount = 0);
+    /**
+     * Look up the current album and title in the library and set the cursor
+     * accordingly. Has to be called if the current album, the current title
+     * or the library changed without going through the cursor.
+     */
+    void updateCursor ();
     /**
      * Set the given title position to be the title currently played and
      * remember this permanently in the current title file. Only the position
@@ -257,9 +330,9 @@ protected:
     /**
      * Get the title first title of the current album.  If there is no title at
      * all return none. 
-     * @return The first title or none.
+     * @return The number of the first title or none.
      */
-    boost::optional<Path> getFirstTitle () const;
+    boost::optional<std::size_t> getFirstTitle () const;
     /**
      * Get the title after the current title in the current album. If it is
      * the last title in the album and wrapAround is false or if there is no
@@ -268,17 +341,19 @@ protected:
      *                 just the next title is returned.
      * @param wrapAround The first title returned if the current title
      *                   is already the last title.
-     * @return The next title or none if there is no next title.
+     * @return The number of the next title or none if there is no next title.
      */
-    boost::optional<Path> getNextTitle (int stepSize, bool wrapAround) const;
+    boost::optional<std::size_t> getNextTitle (int stepSize,
+                                               bool wrapAround) const;
     /**
      * Get the title before the current title in the current album. If it is
      * the first title in the album or if there is no title at all return none. 
      * @param stepSize The number of titles to be stepped over. If 1 is given
      *                 just the previous title is returned.
-     * @return The previous title or none if there is no previous title.
+     * @return The number of the previous title or none if there is no
+     *         previous title.
      */
-    boost::optional<Path> getPreviousTitle (int stepSize) const;
+    boost::optional<std::size_t> getPreviousTitle (int stepSize) const;
     /**
      * Get if the current title is the last title in the current album.
      * @return True if it is the last title, false if not.
@@ -291,15 +366,24 @@ protected:
      */
     int getCurrentTitleNumber() const;
     /**
-     * Recursively go through the given albums path and return all valid
-     * album directories mapped to the list of their mp3 files. A valid album
-     * directory contains at least one mp3 file.
-     * @param albums The path to look for valid mp3 files or album
-     *               sub-directories. This means the albums path itself may
-     *               also be an album path.
-     * @return List of valid album directories.
+     * Check if the durations of the titles of the current album are known.
+     * @return True if the library contains the durations.
      */
-    static std::map<Path, DirectoryList> getAlbumMap(const Path& albums);
+    bool isAlbumDurationKnown() const;
+    /**
+     * Move the current title position by the given number of frames within
+     * the current album. The target title and frame are looked up in the
+     * frame counts stored in the library, so the step may skip any number of
+     * titles. A step beyond the beginning or the end of the album ends in the
+     * first or the last title.
+     * @param frameCount The position within the current title.
+     * @param frameStep The number of frames to be stepped over. Negative to
+     *                  step backward.
+     * @return True if the current title position has moved to another title.
+     *         False if the target is within the current title or if the frame
+     *         counts are not known.
+     */
+    bool stepAlbumPosition (int frameCount, int frameStep);
     /**
      * Start the fast-play action with the given factor of how much the title
      * is played faster than normal.
@@ -318,6 +402,57 @@ protected:
      * the same as calling startFastPlay(0).
      */
     void stopFastPlay ();
+    /**
+     * Jump forward or backward by the current fast-play factor. If the jump
+     * leaves the current title, the number of the target title is said and
+     * playing continues there after the number has been said.
+     * @param framecount The current position within the title.
+     */
+    void fastPlayStep (int framecount);
+    /**
+     * Get the number of frames per second of the current title.
+     * @return The exact value from the library if known, otherwise the value
+     *         estimated from the last status of the player.
+     */
+    int getFramesPerSecond() const;
+    /**
+     * Get the number of titles fast-play steps over at once. The more titles
+     * have been fast-played, the more titles are stepped over.
+     * @return 1, 10 or 100.
+     */
+    int getFastPlayTitleStepSize() const;
+    /**
+     * Completion handler called when the player reached the position a
+     * fast-play step has loaded or jumped to. Fast-play continues with the
+     * next step right away.
+     */
+    void fastPlayPositionReached();
+    /**
+     * Completion handler called when a title has been loaded for playing
+     * backwards. Jumps to one second before the end of the title.
+     */
+    void fastBackwardsTitleLoaded();
+    /**
+     * Continue fast-play at the current title position after the player has
+     * stopped or the number of the title has been said.
+     */
+    void continueFastPlay();
+    /**
+     * Continue playing after the player has replaced a failed mpg123. The
+     * current title is loaded again at the stored title position. If playing
+     * failed several times at about the same position, the next title is
+     * played instead.
+     */
+    void recoverPlayback();
+    /**
+     * Load the current title at the stored title position.
+     */
+    void reloadCurrentTitle();
+    /**
+     * Let the player load the title after the current title in advance, so
+     * it continues without a gap when the current title has ended.
+     */
+    void preloadNextTitle();
     /**
      * Say the given number by concatenating basic numbers. For example first
      * say 200 and then 12 for 212. Add the numbers to say to the corresponding
@@ -329,33 +464,55 @@ protected:
      * the queue.
      */
     void sayNextNumber();
+    /**
+     * Log the time from the start of the program and from boot until the
+     * first title is played.
+     */
+    void logTimeToAudio() const;
 private:
     const Path& _albumsPath;
     Mp3Player& _mp3Player;
-    DirectoryList _albums;
-    std::map<Path, DirectoryList> _albumMap;
+    std::shared_ptr<const Library> _library;
+    std::unique_ptr<LibraryCollection> _libraryCollection;
     std::map<int, Path> _spokenNumberMap;
     Path _currentAlbum;
     boost::optional<TitlePosition> _currentTitlePosition;
+    boost::optional<Cursor> _cursor;
     int _titlePositionUpdateCycle;
     int _frameCountOfLastUpdateCycle;
     int _frameCountPlayed;
     int _frameCountTotal;
     float _secondsPlayed;
+    float _secondsTotal;
     int _fastPlayFactor;
-    bool _fastForwardWaitsForLoadCompleted;
-    bool _fastBackwardsWaitsForLoadCompleted;
-    bool _fastBackwardsWaitsForJumpCompleted;
+    bool _fastPlayWaitsForPlayer;
     int _numberOfFastPlayedTitles;
     std::queue<int> _numbersToSay;
+    bool _reloadAfterPrompt;
+    boost::optional<TitlePosition> _recoveryPosition;
+    int _recoveryCount;
     boost::posix_time::ptime _fastPlayFactorUpdateTime;
+    unsigned long _fastPlaySeekCount;
+    unsigned long _fastPlayDroppedSeekCount;
     bool _paused;
     bool _presentingAlbums;
+    bool _libraryComplete;
+    boost::optional<int> _pendingAlbumNumber;
+    bool _audioStarted;
     RebootSafeString _currentAlbumInfo;
     RebootSafeString _currentTitleInfo;
     static const std::string CURRENT_ALBUM_FILENAME;
     static const std::string CURRENT_TITLE_FILENAME;
     static const boost::posix_time::time_duration FPFI_DURATION;
+    /** Interval of the status if the player only samples the status. It is
+     *  a little longer than the title position update cycle. */
+    static const boost::posix_time::time_duration STATUS_INTERVAL;
+    /** Interval of the status during fast-play, each status is followed by a
+     *  fast-play step. */
+    static const boost::posix_time::time_duration FAST_PLAY_STATUS_INTERVAL;
+    /** The number of times playing is recovered at about the same position
+     *  before the title is skipped. */
+    static const int MAX_RECOVERIES_AT_POSITION;
 };
 
 #endif	/* PLAYBACK_CONTROLLER_HPP */
@@ -11,9 +11,10 @@ using boost::posix_time::milliseconds;
 //==============================================================================
 ThreeControlsPlaybackController::ThreeControlsPlaybackController (
         const path& albumsPath, const path& spokenNumbersPath,
-        Mp3Player& mp3Player, io_service& ioService,
+        const path& volumesPath, Mp3Player& mp3Player, io_service& ioService,
         const time_duration& longPressDuration)
-: _playbackController (albumsPath, spokenNumbersPath, mp3Player)
+: _playbackController (albumsPath, spokenNumbersPath, volumesPath, mp3Player,
+                       ioService)
 , _button1 (milliseconds(10), milliseconds(1000), ioService)
 , _button2 (milliseconds(10), milliseconds(1000), ioService)
 , _rotarySwitch (milliseconds(10), ioService)
@@ -41,7 +41,8 @@ public:
      *                          performed.
      */
     ThreeControlsPlaybackController (const Path& albumsPath,
-            const Path& spokenNumbersPath, Mp3Player& mp3Player,
+            const Path& spokenNumbersPath, const Path& volumesPath,
+            Mp3Player& mp3Player,
             boost::asio::io_service& ioService,
             const TimeDuration& longPressDuration = Seconds (1));
     /**
@@ -6,24 +6,80 @@
  */
 
 #include "Mp3Player.hpp"
+#ifdef USE_LIBMPG123
+#include "Mpg123Library.hpp"
+#else
+#include "Mpg123Process.hpp"
+#endif
+#ifdef USE_ALSA
+#include "AlsaSink.hpp"
+#endif
+#include "FileSink.hpp"
+#include "NullSink.hpp"
 #include "ThreeControlsPlaybackController.hpp"
 #include "Frontend.hpp"
 #include <boost/asio/io_service.hpp>
 #include <boost/filesystem/path.hpp>
 #include <boost/filesystem/operations.hpp>
+#include <csignal>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
 
 using std::cerr;
 using std::endl;
+using std::string;
 using std::shared_ptr;
+using std::unique_ptr;
+using std::ofstream;
 using boost::asio::io_service;
 using boost::filesystem::path;
 using boost::filesystem::exists;
 using boost::filesystem::is_directory;
 
+namespace {
+    /**
+     * Get the factory of the sinks the given output names, i.e. "null",
+     * "file:<path>" or "alsa[:<device>]". mpg123 writes raw audio to these
+     * sinks instead of playing it itself.
+     * @param output The output, usually taken from SEMP3_OUTPUT.
+     * @return The factory, empty if mpg123 plays the audio itself.
+     */
+    PcmSink::Factory getSinkFactory (const char* output) {
+        const string name = (output == nullptr) ? string() : output;
+        if (name.empty()) {
+            return PcmSink::Factory();
+        } else if (name == "null") {
+            return [] {
+                return unique_ptr<PcmSink> (new NullSink());
+            };
+        } else if (name.compare(0, 5, "file:") == 0) {
+            shared_ptr<std::ostream> file (new ofstream (name.substr(5),
+                    ofstream::binary | ofstream::trunc));
+            if (*file) {
+                return [file] {
+                    return unique_ptr<PcmSink> (new FileSink (file));
+                };
+            }
+#ifdef USE_ALSA
+        } else if (name.compare(0, 4, "alsa") == 0) {
+            const string device = (name.size() > 5) ? name.substr(5)
+                                                     : "default";
+            return [device] {
+                return unique_ptr<PcmSink> (new AlsaSink (device));
+            };
+#endif
+        }
+        cerr << "Unable to use output '" << name
+             << "', mpg123 plays the audio itself." << endl;
+        return PcmSink::Factory();
+    }
+}
+
 int main(int argc, char** argv) {
-    if (argc != 3) {
-        cerr << "Usage: semp3 <albums-directory> <spoken-numbers-directory>";
+    if (argc != 3 && argc != 4) {
+        cerr << "Usage: semp3 <albums-directory> <spoken-numbers-directory>"
+             << " [<volumes-directory>]";
         cerr << endl;
         return EXIT_FAILURE;
     }
@@ -47,10 +103,34 @@ int main(int argc, char** argv) {
              << "' is not a directory." << endl;
         return EXIT_FAILURE;
     }
+    path volumes;
+    if (argc == 4) {
+        volumes = argv[3];
+        if (!is_directory (volumes)) {
+            cerr << "Given volumes-directory '" << argv[3]
+                 << "' is not a directory." << endl;
+            return EXIT_FAILURE;
+        }
+    }
+    // Note: Writing to an mpg123 that has terminated has to fail with EPIPE
+    // instead of terminating this program, so mpg123 can be restarted.
+    signal(SIGPIPE, SIG_IGN);
     boost::asio::io_service ioService;
-    Mp3Player mp3Player ("/usr/bin/mpg123", ioService);
+#ifdef USE_LIBMPG123
+    Decoder::Factory createDecoder = Mpg123Library::factory(ioService);
+#else
+    Decoder::Factory createDecoder = Mpg123Process::factory("/usr/bin/mpg123",
+            ioService, getSinkFactory(getenv("SEMP3_OUTPUT")));
+#endif
+#ifdef USE_WIRING_PI
+    // Note: On the device mpg123 only reports its status when asked for it,
+    // which saves the power of most of the wakeups.
+    Mp3Player mp3Player (createDecoder, ioService, true /* sample */);
+#else
+    Mp3Player mp3Player (createDecoder, ioService);
+#endif
     ThreeControlsPlaybackController playbackController (
-            albums, spokenNumbers, mp3Player, ioService);
+            albums, spokenNumbers, volumes, mp3Player, ioService);
     shared_ptr<Frontend> frontend = Frontend::create (playbackController);
     if (!playbackController.resume()) {
         cerr << "Given albums-directory contains no valid album-directory."
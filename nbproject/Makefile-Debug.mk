@@ -35,12 +35,29 @@ OBJECTDIR=${CND_BUILDDIR}/${CND_CONF}/${CND_PLATFORM}
 
 # Object Files
 OBJECTFILES= \
+	${OBJECTDIR}/AlsaSink.o \
 	${OBJECTDIR}/Button.o \
 	${OBJECTDIR}/ChildProgram.o \
+	${OBJECTDIR}/CollationKey.o \
+	${OBJECTDIR}/FileSink.o \
 	${OBJECTDIR}/Frontend.o \
 	${OBJECTDIR}/Id3TagParser.o \
+	${OBJECTDIR}/Library.o \
+	${OBJECTDIR}/LibraryCollection.o \
+	${OBJECTDIR}/LibraryIndex.o \
+	${OBJECTDIR}/LibraryScanner.o \
+	${OBJECTDIR}/LibraryWatcher.o \
+	${OBJECTDIR}/LogRing.o \
+	${OBJECTDIR}/MountWatcher.o \
+	${OBJECTDIR}/Mp3Duration.o \
 	${OBJECTDIR}/Mp3Player.o \
 	${OBJECTDIR}/Mp3Title.o \
+	${OBJECTDIR}/Mpg123Library.o \
+	${OBJECTDIR}/Mpg123Parser.o \
+	${OBJECTDIR}/Mpg123Process.o \
+	${OBJECTDIR}/NullSink.o \
+	${OBJECTDIR}/PcmOutput.o \
+	${OBJECTDIR}/PcmRing.o \
 	${OBJECTDIR}/PlaybackController.o \
 	${OBJECTDIR}/RebootSafeString.o \
 	${OBJECTDIR}/RotarySwitch.o \
@@ -72,6 +89,11 @@ ${CND_DISTDIR}/${CND_CONF}/${CND_PLATFORM}/semp3: ${OBJECTFILES}
 	${MKDIR} -p ${CND_DISTDIR}/${CND_CONF}/${CND_PLATFORM}
 	${LINK.cc} -o ${CND_DISTDIR}/${CND_CONF}/${CND_PLATFORM}/semp3 ${OBJECTFILES} ${LDLIBSOPTIONS}
 
+${OBJECTDIR}/AlsaSink.o: AlsaSink.cpp
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -g -std=c++11 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/AlsaSink.o AlsaSink.cpp
+
 ${OBJECTDIR}/Button.o: Button.cpp
 	${MKDIR} -p ${OBJECTDIR}
 	${RM} "$@.d"
@@ -82,6 +104,16 @@ ${OBJECTDIR}/ChildProgram.o: ChildProgram.cpp
 	${RM} "$@.d"
 	$(COMPILE.cc) -g -std=c++11 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/ChildProgram.o ChildProgram.cpp
 
+${OBJECTDIR}/CollationKey.o: CollationKey.cpp
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -g -std=c++11 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/CollationKey.o CollationKey.cpp
+
+${OBJECTDIR}/FileSink.o: FileSink.cpp
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -g -std=c++11 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/FileSink.o FileSink.cpp
+
 ${OBJECTDIR}/Frontend.o: Frontend.cpp
 	${MKDIR} -p ${OBJECTDIR}
 	${RM} "$@.d"
@@ -92,6 +124,46 @@ ${OBJECTDIR}/Id3TagParser.o: Id3TagParser.cpp
 	${RM} "$@.d"
 	$(COMPILE.cc) -g -std=c++11 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/Id3TagParser.o Id3TagParser.cpp
 
+${OBJECTDIR}/Library.o: Library.cpp
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -g -std=c++11 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/Library.o Library.cpp
+
+${OBJECTDIR}/LibraryCollection.o: LibraryCollection.cpp
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -g -std=c++11 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/LibraryCollection.o LibraryCollection.cpp
+
+${OBJECTDIR}/LibraryIndex.o: LibraryIndex.cpp
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -g -std=c++11 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/LibraryIndex.o LibraryIndex.cpp
+
+${OBJECTDIR}/LibraryScanner.o: LibraryScanner.cpp
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -g -std=c++11 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/LibraryScanner.o LibraryScanner.cpp
+
+${OBJECTDIR}/LibraryWatcher.o: LibraryWatcher.cpp
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -g -std=c++11 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/LibraryWatcher.o LibraryWatcher.cpp
+
+${OBJECTDIR}/LogRing.o: LogRing.cpp
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -g -std=c++11 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/LogRing.o LogRing.cpp
+
+${OBJECTDIR}/MountWatcher.o: MountWatcher.cpp
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -g -std=c++11 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/MountWatcher.o MountWatcher.cpp
+
+${OBJECTDIR}/Mp3Duration.o: Mp3Duration.cpp
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -g -std=c++11 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/Mp3Duration.o Mp3Duration.cpp
+
 ${OBJECTDIR}/Mp3Player.o: Mp3Player.cpp
 	${MKDIR} -p ${OBJECTDIR}
 	${RM} "$@.d"
@@ -102,6 +174,36 @@ ${OBJECTDIR}/Mp3Title.o: Mp3Title.cpp
 	${RM} "$@.d"
 	$(COMPILE.cc) -g -std=c++11 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/Mp3Title.o Mp3Title.cpp
 
+${OBJECTDIR}/Mpg123Library.o: Mpg123Library.cpp
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -g -std=c++11 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/Mpg123Library.o Mpg123Library.cpp
+
+${OBJECTDIR}/Mpg123Parser.o: Mpg123Parser.cpp
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -g -std=c++11 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/Mpg123Parser.o Mpg123Parser.cpp
+
+${OBJECTDIR}/Mpg123Process.o: Mpg123Process.cpp
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -g -std=c++11 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/Mpg123Process.o Mpg123Process.cpp
+
+${OBJECTDIR}/NullSink.o: NullSink.cpp
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -g -std=c++11 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/NullSink.o NullSink.cpp
+
+${OBJECTDIR}/PcmOutput.o: PcmOutput.cpp
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -g -std=c++11 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/PcmOutput.o PcmOutput.cpp
+
+${OBJECTDIR}/PcmRing.o: PcmRing.cpp
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -g -std=c++11 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/PcmRing.o PcmRing.cpp
+
 ${OBJECTDIR}/PlaybackController.o: PlaybackController.cpp
 	${MKDIR} -p ${OBJECTDIR}
 	${RM} "$@.d"
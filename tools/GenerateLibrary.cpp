@@ -0,0 +1,122 @@
+/*
+ * Creates a synthetic albums directory for measuring how semp3 scales with
+ * the size of the library. The titles are sparse files that start with one
+ * second of valid (silent) MPEG 1 Layer III frames, so they hardly use any
+ * disk space but are accepted as mp3 files.
+ */
+
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+using std::ostringstream;
+using std::cout;
+using std::cerr;
+using std::endl;
+
+namespace {
+    /** MPEG 1 Layer III, 128 kbit/s, 44.1 kHz, no CRC, no padding, stereo. */
+    const unsigned char FRAME_HEADER[4] = {0xFF, 0xFB, 0x90, 0x00};
+    /** 144 * 128000 / 44100 bytes. */
+    const size_t FRAME_SIZE = 417;
+    /** About one second of frames with 1152 samples each. */
+    const size_t FRAME_COUNT = 39;
+    /** Number of directories or albums within one group directory. */
+    const unsigned int FAN_OUT = 100;
+
+    bool makeDirectory (const string& directory) {
+        if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST) {
+            cerr << "Unable to create " << directory << ": " << strerror(errno)
+                 << endl;
+            return false;
+        }
+        return true;
+    }
+    bool writeTitle (const string& fileName, const vector<char>& frames,
+                     off_t size) {
+        int fd = open(fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                      0644);
+        if (fd < 0) {
+            cerr << "Unable to create " << fileName << ": " << strerror(errno)
+                 << endl;
+            return false;
+        }
+        bool written = write(fd, frames.data(), frames.size()) ==
+                static_cast<ssize_t>(frames.size()) &&
+                ftruncate(fd, size) == 0;
+        close(fd);
+        return written;
+    }
+}
+
+int main (int argc, char** argv) {
+    if (argc < 4 || argc > 6) {
+        cerr << "Usage: generate-library <albums-directory> <album-count>"
+             << " <titles-per-album> [<depth> [<title-size-in-kB>]]" << endl;
+        cerr << "  depth: Number of directory levels down to the albums"
+             << " (default 1)." << endl;
+        return EXIT_FAILURE;
+    }
+    string albumsDirectory = argv[1];
+    unsigned long albumCount = strtoul(argv[2], nullptr, 10);
+    unsigned long titlesPerAlbum = strtoul(argv[3], nullptr, 10);
+    unsigned int depth = (argc > 4) ? strtoul(argv[4], nullptr, 10) : 1;
+    off_t titleSize = ((argc > 5) ? strtoul(argv[5], nullptr, 10) : 4096) *
+            1024;
+    if (depth == 0) {
+        depth = 1;
+    }
+    vector<char> frames (FRAME_SIZE * FRAME_COUNT, 0);
+    for (size_t i=0; i<FRAME_COUNT; i++) {
+        memcpy(&frames[i * FRAME_SIZE], FRAME_HEADER, sizeof(FRAME_HEADER));
+    }
+    if (titleSize < static_cast<off_t>(frames.size())) {
+        titleSize = frames.size();
+    }
+    if (!makeDirectory(albumsDirectory)) {
+        return EXIT_FAILURE;
+    }
+    for (unsigned long album=0; album<albumCount; album++) {
+        // Note: The albums are grouped by FAN_OUT on each level above the
+        // album directories, e.g. "Group 1/Group 123/Album 12345".
+        string directory = albumsDirectory;
+        for (unsigned int level=depth-1; level>0; level--) {
+            unsigned long group = album;
+            for (unsigned int i=0; i<level; i++) {
+                group /= FAN_OUT;
+            }
+            ostringstream groupName;
+            groupName << directory << "/Group " << group;
+            directory = groupName.str();
+            if (!makeDirectory(directory)) {
+                return EXIT_FAILURE;
+            }
+        }
+        ostringstream albumName;
+        albumName << directory << "/Album " << album + 1;
+        directory = albumName.str();
+        if (!makeDirectory(directory)) {
+            return EXIT_FAILURE;
+        }
+        for (unsigned long title=0; title<titlesPerAlbum; title++) {
+            ostringstream titleName;
+            titleName << directory << "/Track " << title + 1 << ".mp3";
+            if (!writeTitle(titleName.str(), frames, titleSize)) {
+                return EXIT_FAILURE;
+            }
+        }
+    }
+    cout << "Created " << albumCount << " albums with " << titlesPerAlbum
+         << " titles each (" << albumCount * titlesPerAlbum << " titles) in "
+         << albumsDirectory << endl;
+    return EXIT_SUCCESS;
+}
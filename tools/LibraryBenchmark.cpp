@@ -0,0 +1,323 @@
+/*
+ * Measures how semp3 scales with the size of the library, e.g. of a library
+ * created with generate-library:
+ * - Time, peak RSS and system calls for scanning the albums directory without
+ *   (cold) and with (warm) a library index.
+ * - Time for building the library snapshot.
+ * - Latency of the navigation methods of the PlaybackController.
+ * The system calls are counted by tracing a child process with ptrace. The
+ * navigation uses a dummy player that just consumes the mpg123 commands.
+ */
+
+#include "../Library.hpp"
+#include "../LibraryIndex.hpp"
+#include "../Mp3Player.hpp"
+#include "../PlaybackController.hpp"
+#include <boost/asio/io_service.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <sys/ptrace.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <sys/user.h>
+#include <sys/wait.h>
+#include <elf.h>
+#include <signal.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+using std::map;
+using std::set;
+using std::pair;
+using std::function;
+using std::shared_ptr;
+using std::make_shared;
+using std::ofstream;
+using std::cout;
+using std::cerr;
+using std::endl;
+using std::setw;
+using std::fixed;
+using std::setprecision;
+using boost::filesystem::path;
+using boost::filesystem::remove;
+using boost::filesystem::remove_all;
+using boost::filesystem::create_directory;
+using boost::filesystem::permissions;
+using boost::filesystem::perms;
+using boost::filesystem::unique_path;
+using boost::filesystem::temp_directory_path;
+
+typedef std::chrono::steady_clock Clock;
+
+namespace {
+    const unsigned int DEFAULT_OPERATION_COUNT = 1000;
+    /** The system calls reported by name. All others are summed up. */
+    const vector<pair<long, const char*>> SYSTEM_CALL_NAMES = {
+#ifdef SYS_open
+        {SYS_open, "open"},
+#endif
+        {SYS_openat, "openat"},
+        {SYS_close, "close"},
+        {SYS_getdents64, "getdents64"},
+#ifdef SYS_stat
+        {SYS_stat, "stat"},
+#endif
+#ifdef SYS_lstat
+        {SYS_lstat, "lstat"},
+#endif
+#ifdef SYS_fstat
+        {SYS_fstat, "fstat"},
+#endif
+#ifdef SYS_newfstatat
+        {SYS_newfstatat, "newfstatat"},
+#endif
+#ifdef SYS_fstatat64
+        {SYS_fstatat64, "fstatat64"},
+#endif
+#ifdef SYS_stat64
+        {SYS_stat64, "stat64"},
+#endif
+#ifdef SYS_statx
+        {SYS_statx, "statx"},
+#endif
+        {SYS_read, "read"},
+        {SYS_write, "write"},
+#ifdef SYS_mmap
+        {SYS_mmap, "mmap"},
+#endif
+#ifdef SYS_mmap2
+        {SYS_mmap2, "mmap2"},
+#endif
+        {SYS_munmap, "munmap"},
+        {SYS_futex, "futex"},
+    };
+
+    double milliseconds (Clock::duration duration) {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    }
+    long peakResidentSetSize() {
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_maxrss;
+    }
+    void removeIndex (const path& albums) {
+        remove(albums / "a-library.idx");
+        remove(albums / "b-library.idx");
+    }
+    /**
+     * Get the number of the system call a stopped thread is entering.
+     */
+    long getSystemCallNumber (pid_t tid) {
+#if defined(__x86_64__)
+        struct user_regs_struct registers;
+        if (ptrace(PTRACE_GETREGS, tid, nullptr, &registers) == 0) {
+            return registers.orig_rax;
+        }
+#elif defined(__aarch64__)
+        struct user_pt_regs registers;
+        struct iovec vector = {&registers, sizeof(registers)};
+        if (ptrace(PTRACE_GETREGSET, tid, NT_PRSTATUS, &vector) == 0) {
+            return registers.regs[8];
+        }
+#elif defined(__arm__)
+        struct user_regs registers;
+        if (ptrace(PTRACE_GETREGS, tid, nullptr, &registers) == 0) {
+            return registers.uregs[7];
+        }
+#endif
+        return -1;
+    }
+    /**
+     * Run the given function in a child process and count the system calls
+     * of all its threads.
+     * @return The number of calls per system call number.
+     */
+    map<long, unsigned long> countSystemCalls (const function<void()>& run) {
+        map<long, unsigned long> counts;
+        pid_t pid = fork();
+        if (pid == 0) {
+            ptrace(PTRACE_TRACEME, 0, nullptr, nullptr);
+            raise(SIGSTOP);
+            run();
+            _exit(EXIT_SUCCESS);
+        } else if (pid < 0) {
+            return counts;
+        }
+        int status;
+        waitpid(pid, &status, 0);
+        ptrace(PTRACE_SETOPTIONS, pid, nullptr, PTRACE_O_TRACESYSGOOD |
+               PTRACE_O_TRACECLONE | PTRACE_O_EXITKILL);
+        ptrace(PTRACE_SYSCALL, pid, nullptr, nullptr);
+        // Note: Each system call stops a thread twice, on entry and on exit.
+        set<pid_t> inSystemCall;
+        pid_t tid;
+        while ((tid = waitpid(-1, &status, __WALL)) > 0) {
+            if (!WIFSTOPPED(status)) {
+                inSystemCall.erase(tid);
+                continue;
+            }
+            int signal = WSTOPSIG(status);
+            if (signal == (SIGTRAP | 0x80)) {
+                if (inSystemCall.erase(tid) == 0) {
+                    inSystemCall.insert(tid);
+                    counts[getSystemCallNumber(tid)]++;
+                }
+                signal = 0;
+            } else if (signal == SIGTRAP || signal == SIGSTOP) {
+                // Note: Events like the creation of a thread and the initial
+                // stop of a new thread are not passed on.
+                signal = 0;
+            }
+            ptrace(PTRACE_SYSCALL, tid, nullptr, signal);
+        }
+        return counts;
+    }
+    void printSystemCalls (const string& title,
+                           const map<long, unsigned long>& counts) {
+        unsigned long total = 0;
+        for (const auto& count : counts) {
+            total += count.second;
+        }
+        cout << title << ": " << total << " system calls" << endl;
+        if (total == 0) {
+            cout << "    (ptrace not permitted?)" << endl;
+            return;
+        }
+        unsigned long others = total;
+        for (const auto& name : SYSTEM_CALL_NAMES) {
+            auto itCount = counts.find(name.first);
+            if (itCount != counts.end()) {
+                cout << "    " << setw(12) << name.second << ": "
+                     << itCount->second << endl;
+                others -= itCount->second;
+            }
+        }
+        cout << "    " << setw(12) << "others" << ": " << others << endl;
+    }
+    /**
+     * Call the given operation count times and print the mean and the
+     * maximum latency.
+     */
+    void measure (const string& name, unsigned int count,
+                  const function<void()>& operation) {
+        Clock::duration total = Clock::duration::zero();
+        Clock::duration maximum = Clock::duration::zero();
+        for (unsigned int i=0; i<count; i++) {
+            Clock::time_point start = Clock::now();
+            operation();
+            Clock::duration duration = Clock::now() - start;
+            total += duration;
+            maximum = std::max (maximum, duration);
+        }
+        cout << "    " << setw(17) << name << ": mean "
+             << fixed << setprecision(1)
+             << std::chrono::duration<double, std::micro>(total).count() /
+                count
+             << " us, max "
+             << std::chrono::duration<double, std::micro>(maximum).count()
+             << " us" << endl;
+    }
+}
+
+int main (int argc, char** argv) {
+    if (argc < 2 || argc > 3) {
+        cerr << "Usage: library-benchmark <albums-directory>"
+             << " [<operation-count>]" << endl;
+        return EXIT_FAILURE;
+    }
+    const path albums = argv[1];
+    unsigned int operationCount = (argc > 2) ? strtoul(argv[2], nullptr, 10) :
+            DEFAULT_OPERATION_COUNT;
+    // Note: The system calls are counted first since forking is only safe
+    // as long as this process has a single thread.
+    auto scan = [&albums]() {
+        LibraryIndex(albums).scan();
+    };
+    removeIndex(albums);
+    map<long, unsigned long> coldCounts = countSystemCalls(scan);
+    map<long, unsigned long> warmCounts = countSystemCalls(scan);
+
+    cout << "Scan of " << albums << endl;
+    removeIndex(albums);
+    Clock::time_point start = Clock::now();
+    vector<LibraryScanner::Directory> directories = LibraryIndex(albums).scan();
+    Clock::duration coldScan = Clock::now() - start;
+    start = Clock::now();
+    directories = LibraryIndex(albums).scan();
+    Clock::duration warmScan = Clock::now() - start;
+    start = Clock::now();
+    shared_ptr<const Library> library = make_shared<const Library>(directories);
+    Clock::duration build = Clock::now() - start;
+    cout << "    " << directories.size() << " directories, "
+         << library->getAlbumCount() << " albums, "
+         << library->getTitleCount() << " titles" << endl;
+    cout << fixed << setprecision(1);
+    cout << "    cold scan (no index): " << milliseconds(coldScan) << " ms"
+         << endl;
+    cout << "    warm scan (index):    " << milliseconds(warmScan) << " ms"
+         << endl;
+    cout << "    library snapshot:     " << milliseconds(build) << " ms"
+         << endl;
+    cout << "    peak RSS:             " << peakResidentSetSize() << " kB"
+         << endl;
+    printSystemCalls("Cold scan", coldCounts);
+    printSystemCalls("Warm scan", warmCounts);
+    directories.clear();
+    library.reset();
+
+    // Note: The dummy player consumes the commands without playing. Without
+    // a current album file the library is read completely in the
+    // constructor of the playback controller, so album navigation is
+    // available right away.
+    const path workDirectory = temp_directory_path() / unique_path();
+    create_directory(workDirectory);
+    const path player = workDirectory / "mpg123";
+    ofstream playerScript (player.c_str());
+    playerScript << "#!/bin/sh" << endl << "exec cat > /dev/null" << endl;
+    playerScript.close();
+    permissions(player, perms::owner_all);
+    const path spokenNumbers = workDirectory / "spoken-numbers";
+    create_directory(spokenNumbers);
+    remove(albums / "a-current-album.cfg");
+    remove(albums / "b-current-album.cfg");
+    boost::asio::io_service ioService;
+    Mp3Player mp3Player (player.string(), ioService);
+    start = Clock::now();
+    PlaybackController playbackController (albums, spokenNumbers, path(),
+                                           mp3Player, ioService);
+    Clock::duration construction = Clock::now() - start;
+    std::mt19937 random (1);
+    cout << "Navigation (" << operationCount << " operations each)" << endl;
+    cout << "    construction: " << milliseconds(construction) << " ms" << endl;
+    playbackController.resume();
+    measure("next", operationCount, [&]() {
+        playbackController.next(true);
+    });
+    measure("back", operationCount, [&]() {
+        playbackController.back();
+    });
+    measure("jumpToAlbum", operationCount, [&]() {
+        playbackController.jumpToAlbum(random() % 10000 + 1);
+    });
+    measure("presentNextAlbum", operationCount, [&]() {
+        playbackController.presentNextAlbum();
+    });
+    playbackController.resumeAlbum();
+    cout << "    peak RSS: " << peakResidentSetSize() << " kB" << endl;
+    remove_all(workDirectory);
+    return EXIT_SUCCESS;
+}
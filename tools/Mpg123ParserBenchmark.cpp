@@ -0,0 +1,175 @@
+/*
+ * Measures the CPU time per mpg123 status line of the Mpg123Parser compared
+ * to the former parsing in Mp3Player::handleReadInput (copying the received
+ * data into strings and parsing them with istringstreams). The output of
+ * mpg123 is simulated by status lines that are handed over in chunks of the
+ * given size, as they are returned by a read from the pipe. Note that the
+ * former parsing also parsed the partial line at the end of a chunk, so it
+ * recognizes less status lines correctly.
+ */
+
+#include "../Mpg123Parser.hpp"
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/buffers_iterator.hpp>
+#include <boost/asio/streambuf.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+using std::istringstream;
+using std::ostringstream;
+using std::cout;
+using std::cerr;
+using std::endl;
+using std::fixed;
+using std::setprecision;
+
+typedef std::chrono::steady_clock Clock;
+typedef Mpg123Parser::StringRef StringRef;
+
+namespace {
+    const unsigned int DEFAULT_LINE_COUNT = 1000000;
+    const size_t DEFAULT_CHUNK_SIZE = 64;
+
+    /** Counts the status lines that have been parsed correctly. */
+    class Listener : public virtual Mpg123Parser::IListener {
+    public:
+        Listener() : lineCount (0), correctLineCount (0) {}
+        void versionReceived (const StringRef& version) override {}
+        void tagReceived (const StringRef& tag) override {}
+        void streamInfoReceived (const StringRef& streamInfo) override {}
+        void frameReceived (int framecount, int framesLeft, float seconds,
+                            float secondsLeft) override {
+            // Note: The lines are generated such that the sum of the frames
+            // only depends on the frame count.
+            if (framecount >= 0 && framecount + framesLeft ==
+                    framecount - framecount % 10000 + 10000 &&
+                std::abs(seconds - framecount * 0.026f) <=
+                    0.01f * (framecount + 1)) {
+                correctLineCount++;
+            }
+            lineCount++;
+        }
+        void sampleReceived (long sample, long sampleCount) override {}
+        void playStatusReceived (int statusCode,
+                                 const StringRef& reason) override {}
+        void errorReceived (const StringRef& message) override {}
+        unsigned int lineCount;
+        unsigned int correctLineCount;
+    };
+    /**
+     * The parsing of the status lines as done by Mp3Player before the
+     * Mpg123Parser has been introduced.
+     */
+    void parseFormerly (boost::asio::streambuf& inputBuffer,
+                        Listener& listener) {
+        boost::asio::streambuf::const_buffers_type bufs = inputBuffer.data();
+        string input (boost::asio::buffers_begin(bufs),
+                boost::asio::buffers_end(bufs));
+        inputBuffer.consume(inputBuffer.size());
+        istringstream issInput (input);
+        vector<string> messages;
+        string line;
+        while (getline (issInput, line, '\n')) {
+            messages.push_back(line);
+        }
+        for (string message : messages) {
+            size_t messagePos = string::npos;
+            if (message.length() < 3) {
+                continue;
+            }
+            if ((messagePos = message.find(string ("@F")) != string::npos)) {
+                istringstream iss (message.substr(messagePos+2));
+                int framecount;
+                int framesLeft;
+                float seconds;
+                float secondsLeft;
+                iss >> framecount;
+                iss >> framesLeft;
+                iss >> seconds;
+                iss >> secondsLeft;
+                listener.frameReceived(framecount, framesLeft, seconds,
+                                       secondsLeft);
+            }
+        }
+    }
+}
+
+int main (int argc, char** argv) {
+    if (argc > 3) {
+        cerr << "Usage: mpg123-parser-benchmark [<line-count> [<chunk-size>]]"
+             << endl;
+        return EXIT_FAILURE;
+    }
+    unsigned int lineCount = (argc > 1) ? strtoul(argv[1], nullptr, 10) :
+            DEFAULT_LINE_COUNT;
+    size_t chunkSize = (argc > 2) ? strtoul(argv[2], nullptr, 10) :
+            DEFAULT_CHUNK_SIZE;
+    if (lineCount == 0 || chunkSize == 0) {
+        cerr << "The line count and the chunk size must not be zero." << endl;
+        return EXIT_FAILURE;
+    }
+    ostringstream oss;
+    for (unsigned int i=0; i<lineCount; i++) {
+        oss << "@F " << i << " " << 10000 - i % 10000 << " "
+            << fixed << setprecision(2) << i * 0.026 << " "
+            << (10000 - i % 10000) * 0.026 << "\n";
+    }
+    const string output = oss.str();
+
+    Listener formerListener;
+    boost::asio::streambuf inputBuffer;
+    Clock::time_point start = Clock::now();
+    for (size_t offset=0; offset<output.size(); offset+=chunkSize) {
+        size_t length = std::min (chunkSize, output.size() - offset);
+        boost::asio::streambuf::mutable_buffers_type input =
+                inputBuffer.prepare(length);
+        boost::asio::buffer_copy(input,
+                boost::asio::buffer(output.data() + offset, length));
+        inputBuffer.commit(length);
+        // Note: Like async_read_until the former parsing only starts if the
+        // buffer contains a complete line.
+        if (memchr(output.data() + offset, '\n', length) != nullptr) {
+            parseFormerly(inputBuffer, formerListener);
+        }
+    }
+    Clock::duration former = Clock::now() - start;
+
+    Listener listener;
+    Mpg123Parser parser (listener);
+    start = Clock::now();
+    for (size_t offset=0; offset<output.size(); ) {
+        boost::asio::mutable_buffers_1 input = parser.prepare();
+        size_t length = std::min (std::min (chunkSize, output.size() - offset),
+                                  boost::asio::buffer_size(input));
+        memcpy(boost::asio::buffer_cast<char*>(input), output.data() + offset,
+               length);
+        parser.commit(length);
+        offset += length;
+    }
+    Clock::duration current = Clock::now() - start;
+
+    double formerNanoseconds = std::chrono::duration<double, std::nano>(
+            former).count() / lineCount;
+    double currentNanoseconds = std::chrono::duration<double, std::nano>(
+            current).count() / lineCount;
+    cout << lineCount << " status lines in chunks of " << chunkSize
+         << " bytes" << endl;
+    cout << fixed << setprecision(1);
+    cout << "    former parsing: " << formerNanoseconds << " ns per line, "
+         << formerListener.correctLineCount << " lines correct" << endl;
+    cout << "    Mpg123Parser:   " << currentNanoseconds << " ns per line, "
+         << listener.correctLineCount << " lines correct" << endl;
+    cout << "    speed-up:       " << formerNanoseconds / currentNanoseconds
+         << endl;
+    return (listener.correctLineCount == lineCount) ? EXIT_SUCCESS :
+                                                      EXIT_FAILURE;
+}